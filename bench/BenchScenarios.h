@@ -0,0 +1,28 @@
+/**
+ * Scenarios of the benchmark firmware, shared with the simavr runner.
+ *
+ * The firmware writes the scenario id to GPIOR0 when it starts and the id
+ * with BENCH_END set when it ends, BENCH_DONE after the last one.
+ *
+ * Before that it announces the pins the runner drives, from the same
+ * defines as src/main.ino (lib/EpdDht22/Pins.h): the port letter goes to
+ * GPIOR2, then the role with the bit number to GPIOR1.
+ */
+
+#define BENCH_SCENARIOS(X) \
+    X(1, push_1000) \
+    X(2, render_history) \
+    X(3, render_data) \
+    X(4, wake_cycle)
+
+#define BENCH_ID(id, name) BENCH_##name = id,
+enum BenchScenario {
+    BENCH_SCENARIOS(BENCH_ID)
+};
+
+#define BENCH_END 0x80
+#define BENCH_DONE 0xFF
+
+// roles of an announced pin, the low 3 bits are its bit in the port
+#define BENCH_PIN_BUSY 0x10     // held low, the panel is never busy
+#define BENCH_PIN_DHT 0x20      // answers start signals like a DHT22
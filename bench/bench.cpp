@@ -0,0 +1,137 @@
+/**
+ * Benchmark firmware, runs each scenario once under simavr and marks it
+ * in GPIOR0 for `runner`. Built by the `bench-*` environments instead of
+ * src/main.ino.
+ */
+#include <Arduino.h>
+#include <EpdDht22.h>
+#include <PowerDomain.h>
+#include <Pins.h>
+#include "BenchScenarios.h"
+
+#define BENCH_MARK(id) (GPIOR0 = (id))
+
+Settings settings {
+    {
+        PIN_DHT,
+#if DHT22_SENSORS > 1
+        PIN_DHT_2,
+#endif
+#if DHT22_SENSORS > 2
+        PIN_DHT_3,
+#endif
+    },
+    TRANSISTOR_SWITCH_PIN,
+    test,
+    EPD_BUSY_PIN,
+    {
+        30,
+        4,
+        1,
+        READ_DHT22_PAUSE,
+        0,
+        0,
+        VCC_SAVER,
+        VCC_CRITICAL,
+        VCC_HYSTERESIS,
+        TREND_THRESHOLD
+    }
+};
+
+
+// tells `runner` the port and bit of a pin it drives
+static void benchPin(uint8_t role, uint8_t pin){
+    uint8_t mask = digitalPinToBitMask(pin);
+    uint8_t bit = 0;
+    while(mask >>= 1)
+        bit++;
+    GPIOR2 = 'A' + digitalPinToPort(pin) - 1;
+    GPIOR1 = role | bit;
+}
+
+
+// friend of `EpdDht22`, reaches the private render and push functions
+class Bench {
+    public:
+        static void push1000(EpdDht22 *epd);
+        static void renderHistory(EpdDht22 *epd);
+        static void renderData(EpdDht22 *epd);
+        static void wakeCycle(EpdDht22 *epd);
+};
+
+
+// every sample goes through the tiers the way the sketch schedules them
+void Bench::push1000(EpdDht22 *epd){
+    for(uint16_t i=0; i<1000; i++){
+        Dht22Data sample;
+        sample.temperature = 20. + (i % 37) / 10.;
+        sample.humidity = 45. + (i % 11);
+        sample.samples = 1;
+        for(uint8_t s=0; s<DHT22_SENSORS; s++)
+            epd->_push(epd->_fiveMinuteBuffer[s], NULL, sample);
+        epd->_advance(FIVE_MIN_TIER, FIVE_MIN_BUFFER_SIZE);
+
+        if(i % 4 == 3)
+            epd->twentyMinuteAverage();
+        if(i % 24 == 23)
+            epd->twoHourAverage();
+    }
+}
+
+
+void Bench::renderHistory(EpdDht22 *epd){
+    epd->_render(WIDGET_HISTORY, false);
+}
+
+
+void Bench::renderData(EpdDht22 *epd){
+    epd->_render(WIDGET_DATA, false);
+}
+
+
+// active part of `loop()` in src/main.ino with a screen update
+void Bench::wakeCycle(EpdDht22 *epd){
+    epd->startReadout();
+    epd->measureVcc();
+    epd->twentyMinuteAverage();
+    epd->powerUp();
+    epd->printScreen();
+    epd->powerDown();
+    epd->finishReadout();
+    epd->updatePowerProfile();
+}
+
+
+void setup(){
+    benchPin(BENCH_PIN_BUSY, EPD_BUSY_PIN);
+    for(uint8_t i=0; i<DHT22_SENSORS; i++)
+        benchPin(BENCH_PIN_DHT, settings.pinDht22[i]);
+
+    PowerDomain::begin();
+    EpdDht22 *epd = new EpdDht22(&settings);
+
+    BENCH_MARK(BENCH_push_1000);
+    Bench::push1000(epd);
+    BENCH_MARK(BENCH_push_1000 | BENCH_END);
+
+    // renders need a powered panel, which is not part of the measurement
+    epd->powerUp();
+    BENCH_MARK(BENCH_render_history);
+    Bench::renderHistory(epd);
+    BENCH_MARK(BENCH_render_history | BENCH_END);
+
+    BENCH_MARK(BENCH_render_data);
+    Bench::renderData(epd);
+    BENCH_MARK(BENCH_render_data | BENCH_END);
+    epd->powerDown();
+
+    BENCH_MARK(BENCH_wake_cycle);
+    Bench::wakeCycle(epd);
+    BENCH_MARK(BENCH_wake_cycle | BENCH_END);
+
+    BENCH_MARK(BENCH_DONE);
+}
+
+
+void loop(){
+}
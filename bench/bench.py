@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+Builds the benchmark firmware for the AVR boards, runs it under simavr and
+checks cycles, stack depth and memory usage against bench/budgets.ini.
+
+    python bench/bench.py [--update] [ENVIRONMENT ...]
+
+Exits with 1 when a budget is exceeded or not measured. --update rewrites
+the budgets to the measured values plus MARGIN percent instead.
+"""
+import argparse
+import configparser
+import os
+import shutil
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCH = os.path.join(ROOT, 'bench')
+RUNNER = os.path.join(BENCH, 'runner', 'runner')
+
+# environment: (mcu, F_CPU)
+ENVIRONMENTS = {
+    'bench-pro8MHzatmega328': ('atmega328p', 8000000),
+    'bench-uno': ('atmega328p', 16000000),
+    'bench-1284p': ('atmega1284p', 8000000),
+}
+
+# biggest symbols listed in the report
+TOP_SYMBOLS = 15
+
+SYMBOL_SECTIONS = {'t': 'flash', 'd': 'data', 'b': 'bss'}
+
+# headroom of --update over the measured values in percent
+MARGIN = 10
+
+BUDGETS = os.path.join(BENCH, 'budgets.ini')
+
+
+def tool(name):
+    path = shutil.which(name)
+    if path:
+        return path
+    path = os.path.expanduser(os.path.join(
+        '~', '.platformio', 'packages', 'toolchain-atmelavr', 'bin', name))
+    if os.path.exists(path):
+        return path
+    sys.exit('%s not found' % name)
+
+
+def build(environment):
+    subprocess.check_call(['pio', 'run', '-e', environment], cwd=ROOT)
+    return os.path.join(ROOT, '.pio', 'build', environment, 'firmware.elf')
+
+
+def run_scenarios(elf, mcu, frequency):
+    output = subprocess.check_output([RUNNER, elf, mcu, str(frequency)],
+                                     universal_newlines=True)
+    scenarios = {}
+    for line in output.splitlines():
+        name, active, sleeping, stack = line.split()
+        scenarios[name] = {
+            'cycles': int(active),
+            'sleep': int(sleeping),
+            'stack': int(stack),
+        }
+    return scenarios
+
+
+def sections(elf):
+    output = subprocess.check_output([tool('avr-size'), '-A', elf],
+                                     universal_newlines=True)
+    sizes = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in ('.text', '.data', '.bss'):
+            sizes[fields[0][1:]] = int(fields[1])
+
+    # initial values of .data are stored in flash too
+    return {
+        'flash': sizes.get('text', 0) + sizes.get('data', 0),
+        'data': sizes.get('data', 0),
+        'bss': sizes.get('bss', 0),
+    }
+
+
+def symbols(elf):
+    output = subprocess.check_output(
+        [tool('avr-nm'), '-S', '-C', '--size-sort', elf],
+        universal_newlines=True)
+    result = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue
+        section = SYMBOL_SECTIONS.get(fields[2].lower())
+        if section:
+            result.append((fields[3], section, int(fields[1], 16)))
+    return result
+
+
+def check(label, value, limits, key, failures):
+    if key not in limits:
+        return
+    if not limits[key]:
+        failures.append('%s %s: %d, not measured' % (label, key, value))
+    elif value > int(limits[key]):
+        failures.append('%s %s: %d > %s' % (label, key, value, limits[key]))
+
+
+def update(measured):
+    """Rewrites the existing limits in place, comments are kept."""
+    lines = []
+    section = None
+    with open(BUDGETS) as f:
+        for line in f:
+            stripped = line.strip()
+            if stripped.startswith('['):
+                section = stripped[1:-1]
+            elif '=' in stripped and not stripped.startswith(';'):
+                key = stripped.split('=', 1)[0].strip()
+                value = measured.get(section, {}).get(key)
+                if value is not None:
+                    line = '%s = %d\n' % (
+                        key, value + -(-value * MARGIN // 100))
+            lines.append(line)
+    with open(BUDGETS, 'w') as f:
+        f.writelines(lines)
+
+
+def compare(results):
+    """Milliseconds per scenario side by side, paged against full frame."""
+    environments = sorted(results)
+    names = sorted(set(n for scenarios, _ in results.values()
+                       for n in scenarios))
+    print('== ms per scenario')
+    print('%-16s' % 'scenario' + ''.join(
+        ' %24s' % e for e in environments))
+    for name in names:
+        row = '%-16s' % name
+        for environment in environments:
+            scenarios, frequency = results[environment]
+            if name in scenarios:
+                row += ' %24.2f' % (
+                    scenarios[name]['cycles'] * 1000. / frequency)
+            else:
+                row += ' %24s' % '-'
+        print(row)
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('environments', nargs='*', metavar='ENVIRONMENT',
+                        help=', '.join(sorted(ENVIRONMENTS)))
+    parser.add_argument('--update', action='store_true',
+                        help='set the budgets to the measured values')
+    args = parser.parse_args()
+
+    budgets = configparser.ConfigParser(delimiters=('=',))
+    budgets.optionxform = str
+    budgets.read(BUDGETS)
+
+    environments = args.environments or sorted(ENVIRONMENTS)
+    subprocess.check_call(['make', '-s', '-C', os.path.dirname(RUNNER)])
+
+    failures = []
+    results = {}
+    measured = {}
+    for environment in environments:
+        mcu, frequency = ENVIRONMENTS[environment]
+        limits = dict(budgets[environment]) \
+            if budgets.has_section(environment) else {}
+        elf = build(environment)
+
+        print('== %s' % environment)
+        print('%-16s %12s %12s %6s %10s' % (
+            'scenario', 'cycles', 'sleep', 'stack', 'ms'))
+        scenarios = run_scenarios(elf, mcu, frequency)
+        results[environment] = (scenarios, frequency)
+        values = measured[environment] = {}
+        for name in sorted(scenarios):
+            s = scenarios[name]
+            print('%-16s %12d %12d %6d %10.2f' % (
+                name, s['cycles'], s['sleep'], s['stack'],
+                s['cycles'] * 1000. / frequency))
+            values[name + '.cycles'] = s['cycles']
+            values[name + '.stack'] = s['stack']
+
+        print()
+        for section, size in sorted(sections(elf).items()):
+            print('%-6s %6d' % (section, size))
+            values[section] = size
+
+        print()
+        found = symbols(elf)
+        for name, section, size in sorted(found, key=lambda s: -s[2])[
+                :TOP_SYMBOLS]:
+            print('%6d %-5s %s' % (size, section, name))
+        for key in limits:
+            if key.startswith('symbol.'):
+                values[key] = sum(s for n, _, s in found if n == key[7:])
+        print()
+
+        for key, value in sorted(values.items()):
+            check(environment, value, limits, key, failures)
+
+    if len(results) > 1:
+        compare(results)
+
+    if args.update:
+        update(measured)
+        print('budgets updated')
+        return 0
+
+    if failures:
+        print('budget exceeded or not measured:')
+        for failure in failures:
+            print('  ' + failure)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
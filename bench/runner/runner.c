@@ -0,0 +1,252 @@
+/**
+ * Runs the benchmark firmware under simavr and reports cycles and stack
+ * depth of each scenario marked in GPIOR0.
+ *
+ *     runner firmware.elf atmega328p 8000000
+ *
+ * Cycles spent in sleep modes are reported apart from the active ones.
+ * The firmware announces its pins, see BenchScenarios.h: the panel BUSY
+ * line is held low and every DHT22 line answers start signals with a
+ * fixed frame, so readouts take as long as on the board.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "avr_ioport.h"
+#include "../BenchScenarios.h"
+
+// general purpose registers in the data space, same on 328 and 1284P
+#define GPIOR0_ADDR 0x3E
+#define GPIOR1_ADDR 0x4A
+#define GPIOR2_ADDR 0x4B
+
+// simulated seconds before the run is given up
+#define RUN_TIMEOUT 120
+
+#define SCENARIO_SLOTS 0x80
+
+#define DHT_LINES 3
+
+// lows between these are start signals, longer ones are power downs
+#define DHT_START_MIN_US 800
+#define DHT_START_MAX_US 20000
+
+// 45.0 %RH, 21.5 C and the checksum
+static const uint8_t DHT_FRAME[5] = { 0x01, 0xC2, 0x00, 0xD7, 0x9A };
+
+// response after the start signal: 80 us low, 80 us high, 40 bits of
+// 50 us low and 26 us (0) or 70 us (1) high, 50 us low
+#define DHT_STEP_BITS 3
+#define DHT_STEP_LAST (DHT_STEP_BITS + 2 * 40)
+
+typedef struct {
+    const char *name;
+    int done;
+    avr_cycle_count_t start;
+    avr_cycle_count_t cycles;
+    avr_cycle_count_t sleeping;
+    uint16_t startSp;
+    uint16_t minSp;
+} scenario_t;
+
+typedef struct {
+    avr_t *avr;
+    avr_irq_t *irq;
+    int driving;            // the runner raises the line, not the firmware
+    int answering;
+    int low;
+    avr_cycle_count_t lowSince;
+    int step;
+    int frames;
+} dht_t;
+
+static scenario_t scenarios[SCENARIO_SLOTS];
+static int current = -1;
+static int finished;
+
+static dht_t dhts[DHT_LINES];
+static int dhtCount;
+
+
+static uint16_t stack_pointer(avr_t *avr){
+    return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+
+static void marker(struct avr_t *avr, avr_io_addr_t addr, uint8_t v,
+                   void *param){
+    avr->data[addr] = v;
+    if(v == BENCH_DONE){
+        finished = 1;
+        return;
+    }
+
+    scenario_t *s = &scenarios[v & ~BENCH_END];
+    if(!(v & BENCH_END)){
+        s->start = avr->cycle;
+        s->sleeping = 0;
+        s->startSp = s->minSp = stack_pointer(avr);
+        current = v;
+    }
+    else if(current == (v & ~BENCH_END)){
+        s->cycles = avr->cycle - s->start;
+        s->done = 1;
+        current = -1;
+    }
+}
+
+
+static void dht_level(int step, uint32_t *level, uint32_t *usec){
+    if(step >= DHT_STEP_BITS && step < DHT_STEP_LAST){
+        int b = (step - DHT_STEP_BITS) / 2;
+        int one = DHT_FRAME[b >> 3] & (0x80 >> (b & 7));
+        *level = (step - DHT_STEP_BITS) & 1;
+        *usec = *level ? (one ? 70 : 26) : 50;
+        return;
+    }
+    *level = step == 2;
+    *usec = step == 1 || step == 2 ? 80 : 50;
+}
+
+
+// one step of the response per call, the last one releases the line
+static avr_cycle_count_t dht_answer(struct avr_t *avr, avr_cycle_count_t when,
+                                    void *param){
+    dht_t *d = param;
+    uint32_t level = 1, usec = 0;
+    if(d->step <= DHT_STEP_LAST)
+        dht_level(d->step, &level, &usec);
+
+    d->driving = 1;
+    avr_raise_irq(d->irq, level);
+    d->driving = 0;
+
+    if(d->step++ > DHT_STEP_LAST){
+        d->answering = 0;
+        d->frames++;
+        return 0;
+    }
+    return when + avr_usec_to_cycles(avr, usec);
+}
+
+
+// the firmware drove the line, a released start signal starts the answer
+static void dht_line(struct avr_irq_t *irq, uint32_t value, void *param){
+    dht_t *d = param;
+    if(d->driving || d->answering)
+        return;
+    if(!value){
+        if(!d->low){
+            d->low = 1;
+            d->lowSince = d->avr->cycle;
+        }
+        return;
+    }
+    if(!d->low)
+        return;
+
+    d->low = 0;
+    avr_cycle_count_t length = d->avr->cycle - d->lowSince;
+    if(length < avr_usec_to_cycles(d->avr, DHT_START_MIN_US) ||
+       length > avr_usec_to_cycles(d->avr, DHT_START_MAX_US))
+        return;
+    d->answering = 1;
+    d->step = 1;
+    avr_cycle_timer_register_usec(d->avr, 30, dht_answer, d);
+}
+
+
+// port letter in GPIOR2, role and bit in the written value
+static void pin_announce(struct avr_t *avr, avr_io_addr_t addr, uint8_t v,
+                         void *param){
+    avr->data[addr] = v;
+    char port = avr->data[GPIOR2_ADDR];
+    avr_irq_t *irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(port), v & 7);
+    if(!irq){
+        fprintf(stderr, "no port %c\n", port);
+        return;
+    }
+
+    if(v & BENCH_PIN_BUSY)
+        avr_raise_irq(irq, 0);
+    else if((v & BENCH_PIN_DHT) && dhtCount < DHT_LINES){
+        dht_t *d = &dhts[dhtCount++];
+        d->avr = avr;
+        d->irq = irq;
+        avr_irq_register_notify(irq, dht_line, d);
+    }
+}
+
+
+int main(int argc, char *argv[]){
+    if(argc < 4){
+        fprintf(stderr, "usage: %s FIRMWARE.elf MCU F_CPU\n", argv[0]);
+        return 2;
+    }
+
+#define BENCH_NAME(id, label) scenarios[id].name = #label;
+    BENCH_SCENARIOS(BENCH_NAME)
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if(elf_read_firmware(argv[1], &firmware)){
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 2;
+    }
+
+    avr_t *avr = avr_make_mcu_by_name(argv[2]);
+    if(!avr){
+        fprintf(stderr, "unknown mcu %s\n", argv[2]);
+        return 2;
+    }
+    avr_init(avr);
+    avr_load_firmware(avr, &firmware);
+    avr->frequency = strtoul(argv[3], NULL, 10);
+
+    avr_register_io_write(avr, GPIOR0_ADDR, marker, NULL);
+    avr_register_io_write(avr, GPIOR1_ADDR, pin_announce, NULL);
+
+    avr_cycle_count_t limit = (avr_cycle_count_t)avr->frequency * RUN_TIMEOUT;
+    int state = cpu_Running;
+    while(!finished && state != cpu_Done && state != cpu_Crashed &&
+          avr->cycle < limit){
+        int sleeping = avr->state == cpu_Sleeping;
+        avr_cycle_count_t before = avr->cycle;
+        state = avr_run(avr);
+
+        if(current < 0)
+            continue;
+        scenario_t *s = &scenarios[current];
+        if(sleeping)
+            s->sleeping += avr->cycle - before;
+        uint16_t sp = stack_pointer(avr);
+        if(sp < s->minSp)
+            s->minSp = sp;
+    }
+
+    if(!finished){
+        fprintf(stderr, "firmware did not finish (state %d)\n", state);
+        return 1;
+    }
+
+    for(int i=0; i<dhtCount; i++)
+        if(!dhts[i].frames)
+            fprintf(stderr, "DHT22 line %d got no start signal\n", i);
+
+    // name active_cycles sleep_cycles stack_bytes
+    for(int i=0; i<SCENARIO_SLOTS; i++){
+        scenario_t *s = &scenarios[i];
+        if(!s->name)
+            continue;
+        if(!s->done){
+            fprintf(stderr, "%s did not finish\n", s->name);
+            return 1;
+        }
+        printf("%s %llu %llu %u\n", s->name,
+               (unsigned long long)(s->cycles - s->sleeping),
+               (unsigned long long)s->sleeping, s->startSp - s->minSp);
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "BusyWait.h"
+#include "CpuClock.h"
+
+#define NO_BUSY_PIN 0xFF
+
+static volatile uint8_t _busySleepPin = NO_BUSY_PIN;
+
+
+// the interrupt only wakes the MCU, the pin is checked in the wait loop
+EMPTY_INTERRUPT(PCINT2_vect);
+
+
+static void _armPinChange(uint8_t pin){
+    PCMSK2 |= _BV(digitalPinToPCMSKbit(pin));
+    PCIFR = _BV(digitalPinToPCICRbit(pin));
+    PCICR |= _BV(digitalPinToPCICRbit(pin));
+}
+
+
+static void _disarmPinChange(uint8_t pin){
+    PCMSK2 &= ~_BV(digitalPinToPCMSKbit(pin));
+    if(!PCMSK2)
+        PCICR &= ~_BV(digitalPinToPCICRbit(pin));
+}
+
+
+// BUSY could be released between the check and `sleep_cpu()`, so check it
+// again with interrupts disabled
+static void _sleepIfBusy(uint8_t pin, uint8_t mode){
+    set_sleep_mode(mode);
+    noInterrupts();
+    if(digitalRead(pin) == HIGH){
+        sleep_enable();
+        interrupts();
+        sleep_cpu();
+        sleep_disable();
+    }
+    interrupts();
+}
+
+
+void sleepFor(uint16_t ms){
+    // timer0 overflow wakes us up every ~1 ms of timer0 time to keep
+    // `millis()` running; with slow clock that is CPU_SLOW_FACTOR ms
+    SlowClock slow;
+    uint16_t ticks = CpuClock::isSlow() ?
+        (ms + CPU_SLOW_FACTOR - 1) / CPU_SLOW_FACTOR : ms;
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    unsigned long start = millis();
+    while(millis() - start < ticks){
+        sleep_mode();
+    }
+}
+
+
+bool sleepWhileBusy(uint8_t pin, uint16_t timeout){
+    // timeout is measured by `millis()`
+    FullClock full;
+    _armPinChange(pin);
+
+    unsigned long start = millis();
+    bool ready = false;
+
+    while(!(ready = (digitalRead(pin) == LOW))){
+        if(millis() - start >= timeout)
+            break;
+        _sleepIfBusy(pin, SLEEP_MODE_IDLE);
+    }
+
+    // keep the interrupt armed if the display driver still needs it
+    if(pin != _busySleepPin)
+        _disarmPinChange(pin);
+
+    return ready;
+}
+
+
+void enableBusySleep(uint8_t pin){
+#ifndef EPD_NO_BUSY_SLEEP
+    _armPinChange(pin);
+    _busySleepPin = pin;
+#endif
+}
+
+
+void disableBusySleep(){
+    if(_busySleepPin == NO_BUSY_PIN)
+        return;
+    _disarmPinChange(_busySleepPin);
+    _busySleepPin = NO_BUSY_PIN;
+}
+
+
+/**
+ * `delay()` of the Arduino core calls `yield()` while it waits. The display
+ * driver polls BUSY with `delay(1)` during a refresh, so sleeping here takes
+ * the CPU out of the refresh until the controller releases BUSY.
+ */
+void yield(){
+    uint8_t pin = _busySleepPin;
+    if(pin != NO_BUSY_PIN)
+        _sleepIfBusy(pin, EPD_BUSY_SLEEP_MODE);
+}
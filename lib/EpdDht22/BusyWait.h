@@ -0,0 +1,28 @@
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+/**
+ * Waiting with the MCU asleep instead of spinning in `delay()`.
+ *
+ * BUSY pin wake-ups use the pin change interrupt group PCINT2, so the pin
+ * has to be one of the digital pins 0-7 (port D) on the 328 and 16-23
+ * (port C) on the 1284P.
+ */
+
+// Sleep mode used while the display driver polls BUSY. SLEEP_MODE_PWR_DOWN
+// stops timer0, so `millis()` does not advance and the driver's BUSY timeout
+// never fires. Define EPD_NO_BUSY_SLEEP to poll with the CPU running.
+#ifndef EPD_BUSY_SLEEP_MODE
+#define EPD_BUSY_SLEEP_MODE SLEEP_MODE_IDLE
+#endif
+
+// sleep in idle mode for `ms` miliseconds
+void sleepFor(uint16_t ms);
+
+// sleep in idle mode while `pin` is HIGH, at most `timeout` miliseconds;
+// returns false on timeout
+bool sleepWhileBusy(uint8_t pin, uint16_t timeout);
+
+// sleep in every `delay()` (`yield()`) while `pin` is HIGH, until disabled
+void enableBusySleep(uint8_t pin);
+void disableBusySleep();
@@ -0,0 +1,93 @@
+#include "EpdDht22.h"
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+
+// valid range of each field, in the order of `Config`
+static const uint16_t CONFIG_RANGES[CONFIG_FIELDS][2] PROGMEM = {
+    /* slotCycles        */ { 1, 63 },  // 4 slots fit the 8 bit counter
+    /* screenPeriod      */ { 1, HISTORY_SLOTS },
+    /* fullRefreshPeriod */ { 1, 255 },
+    /* readoutPause      */ { 2000, 10000 },
+    /* powerUpSettle     */ { 0, 1000 },
+    /* powerDownSettle   */ { 0, 1000 },
+    /* vccSaver          */ { 1800, 5500 },
+    /* vccCritical       */ { 1800, 5500 },
+    /* vccHysteresis     */ { 0, 1000 },
+    /* trendThreshold    */ { 1, 1000 }
+};
+
+
+// a period in slots has to divide the 20 minute and 2 hour boundaries
+static bool _alignedPeriod(uint16_t slots){
+    if(AVERAGE_SLOTS % slots == 0)
+        return true;
+    return slots % AVERAGE_SLOTS == 0 && HISTORY_SLOTS % slots == 0;
+}
+
+
+uint16_t ConfigStore::_crc(const ConfigRecord *record){
+    const uint8_t *data = (const uint8_t *)record;
+    uint16_t crc = 0xFFFF;
+    for(uint8_t i=0; i<offsetof(ConfigRecord, crc); i++)
+        crc = _crc16_update(crc, data[i]);
+    return crc;
+}
+
+
+/**
+ * Replaces `config` by the EEPROM record when there is a valid one of this
+ * version, keeps the defaults otherwise.
+ */
+bool ConfigStore::load(Config *config){
+    ConfigRecord record;
+    eeprom_read_block(&record, (const void *)CONFIG_ADDRESS, sizeof(record));
+    if(record.magic != CONFIG_MAGIC || record.version != CONFIG_VERSION ||
+       record.crc != _crc(&record))
+        return false;
+
+    *config = record.config;
+    return true;
+}
+
+
+// only the changed bytes are written, EEPROM cells wear out
+void ConfigStore::save(const Config *config){
+    ConfigRecord record;
+    record.magic = CONFIG_MAGIC;
+    record.version = CONFIG_VERSION;
+    record.config = *config;
+    record.crc = _crc(&record);
+    eeprom_update_block(&record, (void *)CONFIG_ADDRESS, sizeof(record));
+}
+
+
+// compiled in defaults apply after the next reset
+void ConfigStore::erase(){
+    uint8_t magic = 0xFF;
+    eeprom_update_block(&magic, (void *)CONFIG_ADDRESS, sizeof(magic));
+}
+
+
+/**
+ * Changes one field when the value is in its range and the configuration
+ * stays consistent. Does not save it.
+ */
+bool ConfigStore::set(Config *config, uint8_t field, uint16_t value){
+    if(field >= CONFIG_FIELDS ||
+       value < pgm_read_word(&CONFIG_RANGES[field][0]) ||
+       value > pgm_read_word(&CONFIG_RANGES[field][1]))
+        return false;
+
+    Config changed = *config;
+    ((uint16_t *)&changed)[field] = value;
+    // the screen period is the one of the normal profile, its updates
+    // follow readouts
+    if(!_alignedPeriod(changed.screenPeriod) ||
+       changed.screenPeriod % POWER_PROFILES[normal].samplePeriod ||
+       changed.vccCritical >= changed.vccSaver)
+        return false;
+
+    *config = changed;
+    return true;
+}
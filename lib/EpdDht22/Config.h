@@ -0,0 +1,54 @@
+#include <Arduino.h>
+
+/**
+ * Tunables of an installation. The sketch compiles in the defaults, a
+ * record in EEPROM replaces them at start and the serial console changes
+ * them, see Console.h.
+ *
+ * All the fields are uint16_t, the console addresses them by their index.
+ * Only append fields and bump CONFIG_VERSION when the layout changes, a
+ * record of another version is ignored.
+ */
+
+#define CONFIG_MAGIC 0xC6
+#define CONFIG_VERSION 1
+
+// record offset in EEPROM
+#define CONFIG_ADDRESS 0
+
+// seconds of a watchdog sleep, `slotCycles` counts them
+#define WATCHDOG_CYCLE_S 8
+
+struct Config {
+    uint16_t slotCycles;        // 8 s watchdog cycles of a sample slot
+    uint16_t screenPeriod;      // slots between screen updates, normal profile
+    uint16_t fullRefreshPeriod; // screen updates between full refreshes, normal
+    uint16_t readoutPause;      // ms between the two reads of the sensor
+    uint16_t powerUpSettle;     // ms to settle after the panel is switched on
+    uint16_t powerDownSettle;   // ms to wait after BUSY before switching off
+    uint16_t vccSaver;          // mV, saver profile below
+    uint16_t vccCritical;       // mV, critical profile below
+    uint16_t vccHysteresis;     // mV above a threshold to step back from it
+    uint16_t trendThreshold;    // hundredths of degree per 2 hours
+};
+
+#define CONFIG_FIELDS (sizeof(Config) / sizeof(uint16_t))
+
+
+struct ConfigRecord {
+    uint8_t magic;
+    uint8_t version;
+    Config config;
+    uint16_t crc;
+};
+
+
+class ConfigStore {
+    private:
+        static uint16_t _crc(const ConfigRecord *record);
+    public:
+        static bool load(Config *config);
+        static void save(const Config *config);
+        static void erase();
+        static bool set(Config *config, uint8_t field, uint16_t value);
+};
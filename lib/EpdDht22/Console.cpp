@@ -0,0 +1,210 @@
+#include "Console.h"
+#include "EpdDht22.h"
+#include "CpuClock.h"
+#include "PowerDomain.h"
+#include <avr/sleep.h>
+#include <util/crc16.h>
+
+#ifdef __AVR_ATmega1284P__
+// RX0 is PD0, in the PCINT3 group
+#define RX_PIN 8
+#define RX_PCMSK PCMSK3
+EMPTY_INTERRUPT(PCINT3_vect);
+#else
+// RX is PD0, PCINT2 shares the empty vector of BusyWait.cpp
+#define RX_PIN 0
+#define RX_PCMSK PCMSK2
+#endif
+
+uint16_t Console::_crc;
+
+
+// first edge on RX wakes the MCU from power-down
+void Console::armWake(){
+    // `_setPinsLow()` leaves RX floating without an adapter, which would
+    // wake it for nothing
+    pinMode(RX_PIN, INPUT_PULLUP);
+    RX_PCMSK |= _BV(digitalPinToPCMSKbit(RX_PIN));
+    PCIFR = _BV(digitalPinToPCICRbit(RX_PIN));
+    PCICR |= _BV(digitalPinToPCICRbit(RX_PIN));
+}
+
+
+void Console::disarmWake(){
+    RX_PCMSK &= ~_BV(digitalPinToPCMSKbit(RX_PIN));
+    if(!RX_PCMSK)
+        PCICR &= ~_BV(digitalPinToPCICRbit(RX_PIN));
+}
+
+
+/**
+ * Answers commands until none comes for CONSOLE_LISTEN_MS. Sleeps in idle
+ * in between, RX and timer0 wake it; the clock stays full for the baud
+ * rate.
+ */
+void Console::listen(EpdDht22 *epd){
+    FullClock full;
+    PowerScope usart(PERIPH_USART);
+
+    int command;
+    while((command = _read()) >= 0)
+        _command(epd, command);
+}
+
+
+// next byte, -1 when none comes for CONSOLE_LISTEN_MS
+int Console::_read(){
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    unsigned long start = millis();
+    while(!Serial.available()){
+        if(millis() - start >= CONSOLE_LISTEN_MS)
+            return -1;
+        sleep_mode();
+    }
+    return Serial.read();
+}
+
+
+// decimal number after leading spaces, ends with any other character
+bool Console::_readNumber(uint16_t *value){
+    int c;
+    do
+        c = _read();
+    while(c == ' ');
+
+    uint32_t number = 0;
+    uint8_t digits = 0;
+    for(; c >= '0' && c <= '9'; c = _read()){
+        number = number * 10 + (c - '0');
+        if(number > 0xFFFF)
+            return false;
+        digits++;
+    }
+    *value = number;
+    return digits > 0;
+}
+
+
+void Console::_printConfig(Config *config){
+    uint16_t *fields = (uint16_t *)config;
+    for(uint8_t i=0; i<CONFIG_FIELDS; i++){
+        if(i)
+            Serial.print(' ');
+        Serial.print(fields[i]);
+    }
+    Serial.println();
+}
+
+
+void Console::_command(EpdDht22 *epd, char command){
+    Config *config = &epd->settings()->config;
+    uint16_t field;
+    uint16_t value;
+
+    switch(command){
+        case 'E':
+            _export(epd);
+            break;
+        case 'C':
+            _printConfig(config);
+            break;
+        case 'S':
+            if(!_readNumber(&field) || !_readNumber(&value) ||
+               field > 0xFF || !ConfigStore::set(config, field, value)){
+                Serial.println(F("?"));
+                break;
+            }
+            ConfigStore::save(config);
+            _printConfig(config);
+            break;
+        case 'D':
+            ConfigStore::erase();
+            Serial.println(F("defaults after reset"));
+            break;
+        default:
+            break;
+    }
+}
+
+
+void Console::_write(const void *data, uint8_t length){
+    const uint8_t *bytes = (const uint8_t *)data;
+    for(uint8_t i=0; i<length; i++)
+        _crc = _crc16_update(_crc, bytes[i]);
+    Serial.write(bytes, length);
+}
+
+
+#ifdef SAMPLE_LOG
+// in sections of at most 255 records
+void Console::_exportLog(SampleLog *log){
+    LogScope scope;
+    log->rewind();
+    uint32_t remaining = log->records();
+    while(remaining){
+        uint8_t count = min(remaining, 255UL);
+        uint8_t section[] = { EXPORT_LOG, 0xFF, 1, count };
+        _write(section, sizeof(section));
+        for(uint8_t i=0; i<count; i++){
+            LogRecord record;
+            log->next(&record);
+            _write(&record, sizeof(record));
+        }
+        remaining -= count;
+    }
+}
+#endif
+
+
+void Console::_export(EpdDht22 *epd){
+    // slots between records of each tier, the slot length is configurable
+    uint8_t slots[TIERS] = {
+        epd->profile()->samplePeriod, AVERAGE_SLOTS, HISTORY_SLOTS
+    };
+    uint16_t slotSeconds = epd->settings()->config.slotCycles *
+                           WATCHDOG_CYCLE_S;
+
+    Serial.write(EXPORT_ACK);
+    Serial.flush();
+    Serial.begin(EXPORT_BAUD);
+    delay(EXPORT_SWITCH_MS);
+
+    _crc = 0xFFFF;
+    uint16_t magic = EXPORT_MAGIC;
+    uint8_t header[] = { EXPORT_VERSION, DHT22_SENSORS };
+    _write(&magic, sizeof(magic));
+    _write(header, sizeof(header));
+    _write(&slotSeconds, sizeof(slotSeconds));
+
+    for(uint8_t tier=0; tier<TIERS; tier++){
+        for(uint8_t sensor=0; sensor<DHT22_SENSORS; sensor++){
+            CircularArray<Dht22Data> *buffer =
+                epd->history((Tier)tier, sensor);
+            uint8_t section[] = {
+                tier, sensor, slots[tier], (uint8_t)buffer->size()
+            };
+            _write(section, sizeof(section));
+
+            for(uint8_t i=0; i<buffer->size(); i++){
+                Dht22Data *data = buffer->get(i);
+                int16_t values[] = {
+                    toTenths(data->temperature), toTenths(data->humidity)
+                };
+                _write(values, sizeof(values));
+                _write(&data->samples, sizeof(data->samples));
+            }
+        }
+    }
+
+#ifdef SAMPLE_LOG
+    _exportLog(epd->sampleLog());
+#endif
+
+    uint8_t end = EXPORT_END;
+    _write(&end, sizeof(end));
+    uint16_t crc = _crc;
+    Serial.write((const uint8_t *)&crc, sizeof(crc));
+
+    Serial.flush();
+    Serial.begin(CONSOLE_BAUD);
+}
@@ -0,0 +1,69 @@
+#include <Arduino.h>
+
+/**
+ * Serial commands, answered in a short listening window after the RX line
+ * woke the MCU from deep sleep.
+ *
+ * The USART stops in power-down and the first edge of a command only wakes
+ * the MCU, so the host repeats a command until it gets an answer. Nothing
+ * runs while nobody sends.
+ *
+ *   E   export: EXPORT_ACK at CONSOLE_BAUD, then the history block at
+ *       EXPORT_BAUD
+ *   C   configuration: the fields of `Config` in their order on one line
+ *   S   set a field, `S<index> <value>`: stored in EEPROM and answered like
+ *       C, or with `?` when the value is not valid
+ *   D   drop the stored configuration, the defaults apply after a reset
+ *
+ * History block, little endian, read by tools/export_csv.py:
+ *
+ *   uint16 EXPORT_MAGIC, uint8 EXPORT_VERSION, uint8 sensors,
+ *   uint16 seconds of a slot
+ *   sections until EXPORT_END:
+ *     uint8 tier, uint8 sensor, uint8 slots between records, uint8 count
+ *     count records, oldest first:
+ *       int16 temperature, int16 humidity in tenths, uint8 samples
+ *     sections of the sample log (SAMPLE_LOG) have tier EXPORT_LOG, sensor
+ *     0xFF and LogRecord records, see SampleLog.h; their slots are those
+ *     of the current slot length
+ *   uint8 EXPORT_END
+ *   uint16 CRC-16 (0xA001 reflected, init 0xFFFF) of everything before it
+ */
+
+#define CONSOLE_BAUD 115200
+#define EXPORT_BAUD 500000
+
+// time to wait for another command after a wake or a command
+#define CONSOLE_LISTEN_MS 200
+
+// time the host gets to switch to EXPORT_BAUD
+#define EXPORT_SWITCH_MS 20
+
+// not in the text of the serial log
+#define EXPORT_ACK 0x06
+
+#define EXPORT_MAGIC 0x5845     // "EX"
+#define EXPORT_VERSION 3
+#define EXPORT_LOG 3
+#define EXPORT_END 0xFF
+
+class EpdDht22;
+class SampleLog;
+struct Config;
+
+
+class Console {
+    private:
+        static uint16_t _crc;
+        static void _write(const void *data, uint8_t length);
+        static void _export(EpdDht22 *epd);
+        static void _exportLog(SampleLog *log);
+        static int _read();
+        static bool _readNumber(uint16_t *value);
+        static void _printConfig(Config *config);
+        static void _command(EpdDht22 *epd, char command);
+    public:
+        static void armWake();
+        static void disarmWake();
+        static void listen(EpdDht22 *epd);
+};
@@ -0,0 +1,66 @@
+#include "CpuClock.h"
+#include "PowerDomain.h"
+#include <avr/power.h>
+
+// millisecond counter of the Arduino core (wiring.c)
+extern volatile unsigned long timer0_millis;
+
+uint8_t CpuClock::_slowUsers = 0;
+uint8_t CpuClock::_fullUsers = 0;
+bool CpuClock::_slow = false;
+unsigned long CpuClock::_slowSince = 0;
+
+
+void CpuClock::_update(){
+    bool slow = _slowUsers > 0 && _fullUsers == 0;
+    if(slow == _slow)
+        return;
+
+    // a byte on the wire would be garbled by the baud rate change
+    if(PowerDomain::enabled(PERIPH_USART))
+        Serial.flush();
+
+    noInterrupts();
+    if(slow){
+        _slowSince = timer0_millis;
+        clock_prescale_set((clock_div_t)CPU_SLOW_PRESCALER);
+    }
+    else {
+        clock_prescale_set(clock_div_1);
+        // timer0 counted 1 ms per CPU_SLOW_FACTOR real miliseconds
+        timer0_millis += (timer0_millis - _slowSince) * (CPU_SLOW_FACTOR - 1);
+    }
+    _slow = slow;
+    interrupts();
+}
+
+
+void CpuClock::acquireSlow(){
+    _slowUsers++;
+    _update();
+}
+
+
+void CpuClock::releaseSlow(){
+    if(_slowUsers)
+        _slowUsers--;
+    _update();
+}
+
+
+void CpuClock::acquireFull(){
+    _fullUsers++;
+    _update();
+}
+
+
+void CpuClock::releaseFull(){
+    if(_fullUsers)
+        _fullUsers--;
+    _update();
+}
+
+
+bool CpuClock::isSlow(){
+    return _slow;
+}
@@ -0,0 +1,48 @@
+#include <Arduino.h>
+
+/**
+ * System clock scaling by `clock_prescale_set()`.
+ *
+ * Waits and other non timing critical work run with the clock divided by
+ * 2^CPU_SLOW_PRESCALER, code which needs exact timing (DHT22 bit decoding,
+ * SPI, Serial) forces full speed. Both are reference counted scopes, full
+ * speed wins. Timer0 slows down with the clock, so `millis()` is corrected
+ * when the clock gets back to full speed; `delay()` and Serial must not be
+ * used while the clock is slow.
+ */
+
+#ifndef CPU_SLOW_PRESCALER
+#define CPU_SLOW_PRESCALER 3    // 8 MHz / 8 = 1 MHz
+#endif
+
+#define CPU_SLOW_FACTOR (1 << CPU_SLOW_PRESCALER)
+
+
+class CpuClock {
+    private:
+        static uint8_t _slowUsers;
+        static uint8_t _fullUsers;
+        static bool _slow;
+        static unsigned long _slowSince;
+        static void _update();
+    public:
+        static void acquireSlow();
+        static void releaseSlow();
+        static void acquireFull();
+        static void releaseFull();
+        static bool isSlow();
+};
+
+
+class SlowClock {
+    public:
+        SlowClock(){ CpuClock::acquireSlow(); }
+        ~SlowClock(){ CpuClock::releaseSlow(); }
+};
+
+
+class FullClock {
+    public:
+        FullClock(){ CpuClock::acquireFull(); }
+        ~FullClock(){ CpuClock::releaseFull(); }
+};
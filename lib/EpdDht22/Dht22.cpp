@@ -0,0 +1,206 @@
+#include "Dht22.h"
+#include "PowerDomain.h"
+#include "CpuClock.h"
+
+// timer1 ticks with prescaler 8, valid for 8 MHz and 16 MHz boards
+#define US_TO_TICKS(us) ((uint16_t)((us) * (F_CPU / 1000000L) / 8))
+
+// millisecond counter of the Arduino core (wiring.c)
+extern volatile unsigned long timer0_millis;
+
+
+Dht22::Dht22(const uint8_t *pins, uint8_t count){
+    _pins = pins;
+    _count = min(count, (uint8_t)DHT22_SENSORS);
+    _miswired = 0;
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        _status[i] = DHT22_TIMEOUT;
+        _temperature[i] = 0;
+        _humidity[i] = 0;
+    }
+
+    // the decoder samples one port, a sensor elsewhere would only time out
+    for(uint8_t i=1; i<_count; i++){
+        if(digitalPinToPort(_pins[i]) == digitalPinToPort(_pins[0]))
+            continue;
+        _miswired |= bit(i);
+        _status[i] = DHT22_WIRING;
+    }
+}
+
+
+void Dht22::begin(){
+    // idle state of the bus is high
+    for(uint8_t i=0; i<_count; i++)
+        pinMode(_pins[i], INPUT_PULLUP);
+}
+
+
+/**
+ * Reads sensors flagged in `pending` (bit per sensor) concurrently and
+ * returns flags of those which still failed.
+ */
+uint8_t Dht22::_readFrames(uint8_t pending){
+    // bit timing needs the full clock
+    FullClock full;
+
+    uint8_t frame[DHT22_SENSORS][5];
+    uint8_t edges[DHT22_SENSORS];
+    uint16_t lastEdge[DHT22_SENSORS];
+    uint8_t pinMask[DHT22_SENSORS];
+    uint8_t portMask = 0;
+
+    volatile uint8_t *port = portInputRegister(digitalPinToPort(_pins[0]));
+
+    for(uint8_t i=0; i<_count; i++){
+        pinMask[i] = (pending & bit(i)) ? digitalPinToBitMask(_pins[i]) : 0;
+        portMask |= pinMask[i];
+        edges[i] = 0;
+        for(uint8_t j=0; j<5; j++)
+            frame[i][j] = 0;
+    }
+
+    // free running timer1 for edge timestamps
+    PowerScope timer1(PERIPH_TIMER1);
+    uint8_t tccr1a = TCCR1A;
+    uint8_t tccr1b = TCCR1B;
+    TCCR1A = 0;
+    TCCR1B = _BV(CS11);
+
+    // start signals
+    for(uint8_t i=0; i<_count; i++){
+        if(!pinMask[i])
+            continue;
+        pinMode(_pins[i], OUTPUT);
+        digitalWrite(_pins[i], LOW);
+    }
+    delayMicroseconds(DHT22_START_SIGNAL);
+
+    // no handler may run between an edge and its timestamp
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t start = TCNT1;
+    for(uint8_t i=0; i<_count; i++){
+        lastEdge[i] = start;
+        if(pinMask[i])
+            pinMode(_pins[i], INPUT_PULLUP);
+    }
+
+    // sample the port until all the frames are complete; only timestamp is
+    // taken before the bookkeeping, so the edges are measured precisely
+    uint8_t receiving = portMask;
+    uint8_t previous = *port & portMask;
+    while(receiving && (uint16_t)(TCNT1 - start) < 
+                       US_TO_TICKS(DHT22_FRAME_TIMEOUT)){
+        uint8_t current = *port & portMask;
+        uint8_t fallen = previous & ~current;
+        previous = current;
+        if(!fallen)
+            continue;
+
+        uint16_t now = TCNT1;
+        for(uint8_t i=0; i<_count; i++){
+            if(!(fallen & pinMask[i]))
+                continue;
+
+            uint16_t period = now - lastEdge[i];
+            lastEdge[i] = now;
+
+            // edge 0 starts the sensor response, edge 1 the first bit; the
+            // period ending at edge n belongs to bit n - 2
+            uint8_t edge = edges[i]++;
+            if(edge >= 2){
+                uint8_t b = edge - 2;
+                if(period > US_TO_TICKS(DHT22_BIT_THRESHOLD))
+                    frame[i][b >> 3] |= (0x80 >> (b & 7));
+            }
+            if(edges[i] == DHT22_EDGES)
+                receiving &= ~pinMask[i];
+        }
+    }
+
+    // timer0 overflows were missed, the pending one is part of the frame
+    uint16_t masked = TCNT1 - start;
+    TIFR0 = _BV(TOV0);
+    timer0_millis += masked / US_TO_TICKS(1000);
+    SREG = sreg;
+
+    TCCR1A = tccr1a;
+    TCCR1B = tccr1b;
+
+    uint8_t failed = 0;
+    for(uint8_t i=0; i<_count; i++){
+        if(!pinMask[i])
+            continue;
+
+        uint8_t *f = frame[i];
+        if(edges[i] < DHT22_EDGES){
+            _status[i] = DHT22_TIMEOUT;
+        }
+        else if((uint8_t)(f[0] + f[1] + f[2] + f[3]) != f[4]){
+            _status[i] = DHT22_CHECKSUM;
+        }
+        else {
+            uint16_t humidity = ((uint16_t)f[0] << 8) | f[1];
+            int16_t temperature = ((uint16_t)(f[2] & 0x7F) << 8) | f[3];
+            if(f[2] & 0x80)
+                temperature = -temperature;
+
+            // a valid checksum does not exclude two flipped bits
+            if(humidity > DHT22_HUMIDITY_MAX ||
+               temperature < DHT22_TEMPERATURE_MIN ||
+               temperature > DHT22_TEMPERATURE_MAX){
+                _status[i] = DHT22_RANGE;
+            }
+            else {
+                _status[i] = DHT22_OK;
+                _humidity[i] = humidity;
+                _temperature[i] = temperature;
+            }
+        }
+
+        if(_status[i] != DHT22_OK)
+            failed |= bit(i);
+    }
+    return failed;
+}
+
+
+/**
+ * Reads all sensors, failed ones are retried together within `attempts`.
+ * Returns number of sensors read successfully.
+ */
+uint8_t Dht22::read(uint8_t attempts){
+    uint8_t pending = ((1 << _count) - 1) & ~_miswired;
+
+    for(uint8_t i=0; i<attempts && pending; i++){
+        if(i > 0)
+            delay(DHT22_RETRY_PAUSE);
+        pending = _readFrames(pending);
+    }
+
+    uint8_t ok = 0;
+    for(uint8_t i=0; i<_count; i++)
+        if(_status[i] == DHT22_OK)
+            ok++;
+    return ok;
+}
+
+
+Dht22Status Dht22::status(uint8_t sensor){
+    return _status[sensor];
+}
+
+
+float Dht22::temperature(uint8_t sensor){
+    if(_status[sensor] != DHT22_OK)
+        return NAN;
+    return _temperature[sensor] / 10.;
+}
+
+
+float Dht22::humidity(uint8_t sensor){
+    if(_status[sensor] != DHT22_OK)
+        return NAN;
+    return _humidity[sensor] / 10.;
+}
@@ -0,0 +1,69 @@
+#include <Arduino.h>
+
+/**
+ * DHT22 (AM2302) driver reading several sensors at once.
+ *
+ * Start signals are issued together and the interleaved responses are
+ * decoded by sampling the whole input port. Timer1 runs free with prescaler
+ * 8 during a readout and every falling edge gets its timestamp. Interrupts
+ * are masked for the frame: at 8 MHz the timer0 and USART handlers would
+ * stretch a 0-bit past DHT22_BIT_THRESHOLD. `millis()` gets the time back
+ * afterwards, serial input arriving during the frame is lost. All data pins
+ * have to be on the same port.
+ *
+ * The sensor converts at most every 2 s and answers with its previous
+ * conversion, so a retry after DHT22_RETRY_PAUSE only helps against a
+ * frame garbled on the wire; it cannot get a newer reading.
+ */
+
+// number of sensors, can be overridden from build flags
+#ifndef DHT22_SENSORS
+#define DHT22_SENSORS 1
+#endif
+
+// the sensor pulls the line low for 50 us before each bit, then keeps it
+// high 26-28 us for `0` and 70 us for `1`
+#define DHT22_START_SIGNAL 1100     // host start signal in us
+#define DHT22_BIT_THRESHOLD 100     // falling-to-falling period in us
+#define DHT22_FRAME_TIMEOUT 8000    // whole frame in us
+#define DHT22_RETRIES 3
+#define DHT22_RETRY_PAUSE 50        // pause between retries in ms, see above
+
+// limits of the sensor in tenths, anything outside is a corrupted frame
+#define DHT22_TEMPERATURE_MIN -400
+#define DHT22_TEMPERATURE_MAX 800
+#define DHT22_HUMIDITY_MAX 1000
+
+// response edge, first bit edge, 40 bit edges
+#define DHT22_EDGES 42
+
+
+enum Dht22Status {
+    DHT22_OK,
+    DHT22_TIMEOUT,
+    DHT22_CHECKSUM,
+    DHT22_RANGE,
+    DHT22_WIRING    // not on the port of the first sensor, never read
+};
+
+
+class Dht22 {
+    private:
+        const uint8_t *_pins;
+        uint8_t _count;
+        uint8_t _miswired;  // flags of sensors with DHT22_WIRING
+        Dht22Status _status[DHT22_SENSORS];
+
+        // tenths of degree / percent, as sent by the sensor
+        int16_t _temperature[DHT22_SENSORS];
+        uint16_t _humidity[DHT22_SENSORS];
+
+        uint8_t _readFrames(uint8_t pending);
+    public:
+        Dht22(const uint8_t *pins, uint8_t count);
+        void begin();
+        uint8_t read(uint8_t attempts = DHT22_RETRIES);
+        Dht22Status status(uint8_t sensor);
+        float temperature(uint8_t sensor);
+        float humidity(uint8_t sensor);
+};
@@ -1,19 +1,30 @@
 #include "EpdDht22.h"
+#include "BusyWait.h"
+#include "PowerDomain.h"
+#include "CpuClock.h"
+#include "MemoryProbe.h"
 #include "fonts/Georgia-weather18pt7b.h"
 #include "Fonts/TomThumb.h"
-#include <math.h>
 
-// delay after power on in miliseconds
-#define SWITCH_POWER_DELAY 500
+// longest BUSY period (full refresh) in miliseconds
+#define EPD_BUSY_TIMEOUT 5000
 
-// pause between DHT22 readouts
-#define READ_DHT22_PAUSE 2500
+// e-paper control pins, CS is the hardware SS
+#ifndef EPD_DC_PIN
+#define EPD_DC_PIN 8
+#endif
+#ifndef EPD_RST_PIN
+#define EPD_RST_PIN 9
+#endif
 
 // left margin
 #define MARGIN_LEFT 30
 #define TEMPERATURES_TOP 50
 #define LINE 50
 
+// height of a data row when there are more sensors
+#define SENSOR_ROW ((GRAPH_Y - TEMPERATURES_TOP) / DHT22_SENSORS)
+
 const uint16_t GRAPH_X = 8;
 const uint16_t GRAPH_Y = 128;
 const uint16_t GRAPH_WIDTH = 190;
@@ -27,34 +38,315 @@ const uint16_t Y_AXIS_X = (X_AXIS_X);
 const uint16_t Y_AXIS_Y = (X_AXIS_Y);
 const uint16_t Y_AXIS_HEIGHT = (GRAPH_HEIGHT);
 
+// y-axis steps in tenths of degree, the first one which fits wins
+const int16_t AXIS_STEPS[] = { 5, 10, 20, 50, 100, 200 };
+
+// screen areas of the widgets, indexed by `Widget`
+const Window WIDGET_WINDOWS[] = {
+    /* data    */ { 0, 20, 200, GRAPH_Y - 30 },
+    /* vcc     */ { 0, 0, 50, 20 },
+    /* history */ { GRAPH_X, GRAPH_Y - 10, GRAPH_WIDTH, GRAPH_HEIGHT + 10 }
+};
+
+#ifdef EPD_FULL_FRAME
+static uint8_t frameBuffer[FRAME_BUFFER_SIZE];
+#endif
+
+const ProfileSettings POWER_PROFILES[] = {
+    /* normal   */ { 1, 4, 1, true },    // cadence from `Config`
+    /* saver    */ { 2, 8, 6, false },
+    /* critical */ { 4, 24, 12, false }
+};
+
 
 EpdDht22::EpdDht22(Settings *settings){
     _settings = settings;
+    ConfigStore::load(&settings->config);
+    _displayPowered = false;
+    _readoutPending = false;
+    _readoutStarted = 0;
+    _vcc = 0;
+    _profile = normal;
+    _screenUpdates = 0;
+    _freshSamples = 0;
+    _onDemand = NULL;
+    memset(_frameHashes, 0, sizeof(_frameHashes));
+    // no axis until the buffers are restored, `_updateAxis()` compares to it
+    memset(&_axis, 0, sizeof(_axis));
+
+    // devices are initialized on first use
+    _dht22 = NULL;
+    _display = NULL;
+#ifdef SAMPLE_LOG
+    _log = new SampleLog();
+    LogDevice::panelRail(settings->pinTransistorSwitch,
+                         &settings->config.powerUpSettle);
+#endif
+    _displayBlank = true;
+    // initialize buffers, continue with the previous content if it survived
+    // the reset
+    PersistentState *state = &persistentState;
+    _restored = persistentStateValid();
+    if(!_restored)
+        persistentStateReset();
+
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        _fiveMinuteBuffer[i] = new CircularArray<Dht22Data>(
+            state->fiveMinute[i], FIVE_MIN_BUFFER_SIZE);
+        _twentyMinuteBuffer[i] = new CircularArray<Dht22Data>(
+            state->twentyMinute[i], TWENTY_MIN_BUFFER_SIZE);
+        _twoHourBuffer[i] = new CircularArray<Dht22Data>(
+            state->twoHour[i], TWO_HOURS_BUFFER_SIZE);
+
+        _twoHourStats[i] = new TierStats(TWO_HOURS_BUFFER_SIZE);
+
+        if(!_restored)
+            continue;
+
+        _restoreBuffer(_fiveMinuteBuffer[i], NULL,
+                       state->fiveMinute[i], FIVE_MIN_BUFFER_SIZE,
+                       &state->tiers[FIVE_MIN_TIER]);
+        _restoreBuffer(_twentyMinuteBuffer[i], NULL,
+                       state->twentyMinute[i], TWENTY_MIN_BUFFER_SIZE,
+                       &state->tiers[TWENTY_MIN_TIER]);
+        _restoreBuffer(_twoHourBuffer[i], _twoHourStats[i],
+                       state->twoHour[i], TWO_HOURS_BUFFER_SIZE,
+                       &state->tiers[TWO_HOUR_TIER]);
+    }
 
-    // initialize devices
-    _dht22 = new DHT(_settings->pinDht22, DHT_TYPE);
-    _display = new GxEPD2_AVR_BW(GxEPD2::GDEP015OC1, /*CS=*/ SS, /*DC=*/ 8,
-                                 /*RST=*/ 9, /*BUSY=*/ 7);
-    // initialize buffers
-    _fiveMinuteBuffer = new CircularArray<Dht22Data>(_fmb, 
-                                                     FIVE_MIN_BUFFER_SIZE);
-    _twentyMinuteBuffer = new CircularArray<Dht22Data>(_tmb, 
-                                                       TWENTY_MIN_BUFFER_SIZE);
-    _twoHourBuffer = new CircularArray<Dht22Data>(_2hb, 
-                                                  TWO_HOURS_BUFFER_SIZE);
+    if(_restored){
+        // buffers are refilled from the beginning of their arrays
+        for(uint8_t t=0; t<TIERS; t++){
+            TierIndex *index = &state->tiers[t];
+            uint8_t capacity = t == FIVE_MIN_TIER ? FIVE_MIN_BUFFER_SIZE :
+                t == TWENTY_MIN_TIER ? TWENTY_MIN_BUFFER_SIZE :
+                TWO_HOURS_BUFFER_SIZE;
+            index->head = index->count % capacity;
+        }
+        persistentStateSeal();
+    }
+    _updateAxis();
+    _scaleHistory(0);
 
     // set all the pins low for better power saving
     _setPinsLow();
+}
 
-    // start up DHT22 sensor
-    _dht22->begin();
 
+bool EpdDht22::restored(){
+    return _restored;
+}
+
+
+Settings *EpdDht22::settings(){
+    return _settings;
+}
+
+
+/**
+ * Pushes saved samples in their order into a freshly created buffer, which
+ * fills its array from the first slot.
+ */
+void EpdDht22::_restoreBuffer(CircularArray<Dht22Data> *buffer,
+                              TierStats *stats, Dht22Data *data,
+                              uint8_t capacity, TierIndex *index){
+    Dht22Data saved[TWO_HOURS_BUFFER_SIZE];
+    uint8_t count = min(index->count, capacity);
+    uint8_t first = (index->head + capacity - count) % capacity;
+
+    for(uint8_t i=0; i<count; i++)
+        saved[i] = data[(first + i) % capacity];
+    for(uint8_t i=0; i<count; i++)
+        _push(buffer, stats, saved[i]);
+}
+
+
+// pushes into a buffer and keeps its statistics, if any, up to date
+void EpdDht22::_push(CircularArray<Dht22Data> *buffer, TierStats *stats,
+                     Dht22Data value){
+    if(!stats){
+        buffer->push(value);
+        return;
+    }
+
+    bool rescan = false;
+    if(stats->full()){
+        Dht22Data *oldest = buffer->get(0);
+        rescan = stats->evict(toTenths(oldest->temperature), oldest->samples);
+    }
+
+    buffer->push(value);
+    stats->add(toTenths(value.temperature), value.samples);
+
+    // evicted sample was the minimum or maximum
+    if(rescan){
+        stats->clearRange();
+        for(uint16_t i=0; i<buffer->size(); i++)
+            if(buffer->get(i)->samples)
+                stats->extendRange(toTenths(buffer->get(i)->temperature));
+    }
+}
+
+
+// moves ring position of a tier after a push to all the sensors
+void EpdDht22::_advance(Tier tier, uint8_t capacity){
+    TierIndex *index = &persistentState.tiers[tier];
+    index->head = (index->head + 1) % capacity;
+    if(index->count < capacity)
+        index->count++;
+    if(index->fresh < capacity)
+        index->fresh++;
+    persistentStateSeal();
+}
+
+
+static float _median(float a, float b, float c){
+    if(a > b){
+        float t = a;
+        a = b;
+        b = t;
+    }
+    // a <= b
+    if(c >= b)
+        return b;
+    return c > a ? c : a;
+}
+
+
+/**
+ * Median of the last three valid readings of a sensor, removes single spikes
+ * which passed the checksum. Values go through until the window is full.
+ */
+Dht22Data EpdDht22::_filter(uint8_t sensor, Dht22Data sample){
+    Dht22Data *recent = persistentState.recent[sensor];
+    uint8_t *count = &persistentState.recentCount[sensor];
+
+    for(uint8_t i=1; i<MEDIAN_WINDOW; i++)
+        recent[i - 1] = recent[i];
+    recent[MEDIAN_WINDOW - 1] = sample;
+    if(*count < MEDIAN_WINDOW)
+        (*count)++;
+    if(*count < MEDIAN_WINDOW)
+        return sample;
+
+    sample.temperature = _median(recent[0].temperature, recent[1].temperature,
+                                 recent[2].temperature);
+    sample.humidity = _median(recent[0].humidity, recent[1].humidity,
+                              recent[2].humidity);
+    return sample;
+}
+
+
+// rounds down to a multiple of `step`, negative values too
+static int16_t _floorTo(int16_t value, int16_t step){
+    int16_t remainder = value % step;
+    if(remainder < 0)
+        remainder += step;
+    return value - remainder;
+}
+
+
+/**
+ * Picks the y-axis of the history graph from min/max of the two hour tier:
+ * the smallest nice step (0.5, 1, 2, 5, ... degrees) which covers the range
+ * in at most AXIS_MAX_INTERVALS. Humidity gets whole HUMIDITY_STEPs up to
+ * 100 %. Ranges are never empty. Returns true when the axes changed.
+ */
+bool EpdDht22::_updateAxis(){
+    TierStats *stats = _twoHourStats[0];
+    Axis previous = _axis;
+    _axis.intervals = 0;
+    if(!stats->count())
+        return previous.intervals != 0;
+
+    int16_t low = stats->minimum();
+    int16_t high = stats->maximum();
+    int16_t down = 0;
+    int16_t up = 0;
+    int16_t step = 0;
+    for(uint8_t i=0; i<sizeof(AXIS_STEPS) / sizeof(AXIS_STEPS[0]); i++){
+        step = AXIS_STEPS[i];
+        down = _floorTo(low, step);
+        up = -_floorTo(-high, step);
+        if(up == down)
+            up += step;
+        if((up - down) / step <= AXIS_MAX_INTERVALS)
+            break;
+    }
+
+    _axis.down = down;
+    _axis.step = step;
+    _axis.intervals = (up - down) / step;
+    for(uint8_t i=0; i<=_axis.intervals; i++)
+        _axis.tickY[i] = (uint16_t)i * GRAPH_HEIGHT / _axis.intervals;
+
+    // humidity is not in the statistics, a dozen samples are scanned
+    CircularArray<Dht22Data> *history = _twoHourBuffer[0];
+    low = 1000;
+    high = 0;
+    for(uint8_t i=0; i<history->size(); i++){
+        if(!history->get(i)->samples)
+            continue;
+        int16_t humidity = toTenths(history->get(i)->humidity);
+        low = min(low, humidity);
+        high = max(high, humidity);
+    }
+    step = HUMIDITY_STEP * 10;
+    down = _floorTo(low, step);
+    up = min(-_floorTo(-high, step), 1000);
+    if(up == down){
+        if(up < 1000)
+            up += step;
+        else
+            down -= step;
+    }
+    _axis.humidityDown = down / 10;
+    _axis.humidityUp = up / 10;
+
+    return _axis.down != previous.down || _axis.step != previous.step ||
+           _axis.intervals != previous.intervals ||
+           _axis.humidityDown != previous.humidityDown ||
+           _axis.humidityUp != previous.humidityUp;
+}
+
+
+// pixels of `offset` on an axis which spans `span` over the graph height
+static uint8_t _scale(int16_t offset, int16_t span){
+    if(offset < 0)
+        offset = 0;
+    if(offset > span)
+        offset = span;
+    return (int32_t)offset * GRAPH_HEIGHT / span;
+}
+
+
+// heights of the history graph from position `first` on, by the current axes
+void EpdDht22::_scaleHistory(uint8_t first){
+    if(!_axis.intervals)
+        return;
+
+    CircularArray<Dht22Data> *history = _twoHourBuffer[0];
+    int16_t span = (int16_t)_axis.intervals * _axis.step;
+    int16_t humidityDown = _axis.humidityDown * 10;
+    int16_t humiditySpan = _axis.humidityUp * 10 - humidityDown;
+    for(uint8_t i=first; i<history->size(); i++){
+        Dht22Data *data = history->get(i);
+        _barHeights[i] = _scale(toTenths(data->temperature) - _axis.down, span);
+        _humidityHeights[i] = _scale(toTenths(data->humidity) - humidityDown,
+                                     humiditySpan);
+    }
 }
 
 
 long EpdDht22::readVcc() { 
+    PowerScope adc(PERIPH_ADC);
     long result; // Read 1.1V reference against AVcc 
+#ifdef __AVR_ATmega1284P__
+    // bandgap is channel 30 there
+    ADMUX = _BV(REFS0) | _BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+#else
     ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1); 
+#endif
     delay(2); // Wait for Vref to settle 
     ADCSRA |= _BV(ADSC); // Convert 
     while (bit_is_set(ADCSRA,ADSC)); 
@@ -65,18 +357,85 @@ long EpdDht22::readVcc() {
 }
 
 
-Dht22Data EpdDht22::_getAverageValues(CircularArray<Dht22Data> *buffer){
-    Dht22Data sum = { 0., 0. };
-    Dht22Data average = { 0., 0. };
+long EpdDht22::measureVcc(){
+    // keep ADC on for all the samples
+    PowerScope adc(PERIPH_ADC);
+    long vcc = 0;
+    for(uint8_t i=0; i<5; i++){
+        vcc += readVcc();
+    }
+    _vcc = vcc / 5;
+    return _vcc;
+}
 
-    for(uint16_t i=0; i<buffer->size(); i++){
+
+PowerProfile EpdDht22::updatePowerProfile(){
+    long vcc = _vcc ? _vcc : measureVcc();
+    Config *config = &_settings->config;
+
+    PowerProfile target = normal;
+    if(vcc < config->vccCritical)
+        target = critical;
+    else if(vcc < config->vccSaver)
+        target = saver;
+
+    // step back to a less saving profile only when Vcc recovered well above
+    // the threshold of that profile, so the profile does not flap around it;
+    // from critical only to saver when Vcc cleared just the lower threshold
+    if(target < _profile){
+        if(target == normal &&
+           vcc < config->vccSaver + config->vccHysteresis)
+            target = saver;
+        if(target == saver &&
+           vcc < config->vccCritical + config->vccHysteresis)
+            target = critical;
+        if(target > _profile)
+            target = _profile;
+    }
+
+    _profile = target;
+    return _profile;
+}
+
+
+// the configuration can change any time from the console
+const ProfileSettings *EpdDht22::profile(){
+    _profileSettings = POWER_PROFILES[_profile];
+    if(_profile == normal){
+        _profileSettings.screenPeriod = _settings->config.screenPeriod;
+        _profileSettings.fullRefreshPeriod =
+            _settings->config.fullRefreshPeriod;
+    }
+    return &_profileSettings;
+}
+
+
+/**
+ * Average of the `newest` entries weighted by the number of valid readings,
+ * so failed readouts do not count. Returns zero samples when there was none.
+ */
+Dht22Data EpdDht22::_getAverageValues(CircularArray<Dht22Data> *buffer,
+                                      uint8_t newest){
+    Dht22Data sum = { 0., 0., 0 };
+    Dht22Data average = { 0., 0., 0 };
+    uint16_t samples = 0;
+
+    for(uint16_t i=buffer->size() - min(newest, (uint8_t)buffer->size());
+        i<buffer->size(); i++){
         Dht22Data *_tmp = buffer->get(i);
-        sum.temperature += _tmp->temperature;
-        sum.humidity += _tmp->humidity;
+        if(!_tmp->samples)
+            continue;
+        sum.temperature += _tmp->temperature * _tmp->samples;
+        sum.humidity += _tmp->humidity * _tmp->samples;
+        samples += _tmp->samples;
     }
 
-    average.temperature = sum.temperature / (buffer->size());
-    average.humidity = sum.humidity / (buffer->size());
+    if(!samples)
+        return average;
+
+    average.temperature = sum.temperature / samples;
+    average.humidity = sum.humidity / samples;
+    average.samples = min(samples, (uint16_t)255);
     return average;
 }
 
@@ -86,236 +445,638 @@ void EpdDht22::_setPinsLow(){
         pinMode(i, INPUT_PULLUP);
         digitalWrite(i, LOW);
     }
+#ifdef SAMPLE_LOG
+    // log memory stays powered, keep it deselected
+    pinMode(LOG_CS_PIN, INPUT_PULLUP);
+#endif
 }
 
 
 void EpdDht22::_debugDataBuffer(){
-    for(uint16_t i=0; i<_fiveMinuteBuffer->size(); i++){
-        Serial.print(_fiveMinuteBuffer->get(i)->temperature);
-        if(i != _fiveMinuteBuffer->size() - 1) Serial.print(", ");
+    FixedText text;
+    for(uint8_t s=0; s<DHT22_SENSORS; s++){
+        CircularArray<Dht22Data> *buffer = _fiveMinuteBuffer[s];
+        for(uint16_t i=0; i<buffer->size(); i++){
+            formatFixed(text, toTenths(buffer->get(i)->temperature), 1, 1);
+            Serial.print(text);
+            if(i != buffer->size() - 1) Serial.print(", ");
+        }
+        Serial.println();
     }
-    Serial.println();
-
 }
 
 void EpdDht22::_debugHistoryBuffer(){
-    for(uint16_t i=0; i<_twoHourBuffer->size(); i++){
-        Serial.print(_twoHourBuffer->get(i)->temperature);
-        if(i != _twoHourBuffer->size() - 1) Serial.print(", ");
+    FixedText text;
+    CircularArray<Dht22Data> *buffer = _twoHourBuffer[0];
+    for(uint16_t i=0; i<buffer->size(); i++){
+        formatFixed(text, toTenths(buffer->get(i)->temperature), 1, 1);
+        Serial.print(text);
+        if(i != buffer->size() - 1) Serial.print(", ");
     }
     Serial.println();
 }
 
 
-void EpdDht22::_writeLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1){
-    _display->writeLine(x0, y0, x1, y1, GxEPD_BLACK);
+void EpdDht22::_writeLine(Adafruit_GFX *gfx, uint16_t x0, uint16_t y0,
+                          uint16_t x1, uint16_t y1){
+    gfx->writeLine(x0, y0, x1, y1, GxEPD_BLACK);
 }
 
 
-void EpdDht22::_drawBar(float value, uint16_t xPos){
-    // compute height of bar
-    uint16_t height = (
-        round(((value - _range.down) / _range.size) * GRAPH_HEIGHT)
-    );
-    // print bar
-    _display->drawRect((xPos - 5), (Y_AXIS_Y - height), 10, height, 
-                       GxEPD_BLACK);
+void EpdDht22::_drawBar(Adafruit_GFX *gfx, uint8_t height, uint16_t xPos){
+    gfx->drawRect((xPos - 5), (Y_AXIS_Y - height), 10, height, GxEPD_BLACK);
+}
+
+
+// small arrow centered at `x`, `y`, nothing when steady
+void EpdDht22::_drawTrend(Adafruit_GFX *gfx, uint8_t sensor, uint16_t x,
+                          uint16_t y){
+    Trend t = trend(sensor);
+    if(t == rising)
+        gfx->fillTriangle(x - 5, y + 4, x + 5, y + 4, x, y - 5, GxEPD_BLACK);
+    else if(t == falling)
+        gfx->fillTriangle(x - 5, y - 4, x + 5, y - 4, x, y + 5, GxEPD_BLACK);
+}
+
+
+void EpdDht22::_startSensor(){
+    if(!_dht22)
+        _dht22 = new Dht22(_settings->pinDht22, DHT22_SENSORS);
+
+    // the bus idles in INPUT_PULLUP, `_setPinsLow()` turned the pull-up off
+    _dht22->begin();
 }
 
 
 void EpdDht22::powerUp(){
+    if(_displayPowered)
+        return;
+
+    if(!_display)
+        _display = new GxEPD2_AVR_BW(GxEPD2::GDEP015OC1, /*CS=*/ SS,
+                                     /*DC=*/ EPD_DC_PIN,
+                                     /*RST=*/ EPD_RST_PIN,
+                                     /*BUSY=*/ _settings->pinEpdBusy);
+
     pinMode(_settings->pinTransistorSwitch, OUTPUT);
     digitalWrite(_settings->pinTransistorSwitch, HIGH);
-    delay(SWITCH_POWER_DELAY);
-    _display->init();
+    sleepFor(_settings->config.powerUpSettle);
+    PowerDomain::acquire(PERIPH_SPI);
+    // SPI transfers and the driver's BUSY timeouts need the full clock
+    CpuClock::acquireFull();
+
+    // controller RAM is lost with the power, a partial refresh would diff
+    // against garbage; the initial init clears both buffers and the driver
+    // makes the first refresh full
+    _display->init(0, true);
+    _displayBlank = true;
+    _displayPowered = true;
+
+    // sleep instead of polling BUSY while the panel refreshes
+    enableBusySleep(_settings->pinEpdBusy);
 }
 
 
 void EpdDht22::powerDown(){
-    delay(SWITCH_POWER_DELAY);
+    bool powered = _displayPowered;
+
+    // let the controller finish whatever it is doing before power is cut
+    if(powered){
+        disableBusySleep();
+        pinMode(_settings->pinEpdBusy, INPUT);
+        sleepWhileBusy(_settings->pinEpdBusy, EPD_BUSY_TIMEOUT);
+        sleepFor(_settings->config.powerDownSettle);
+        _displayPowered = false;
+    }
     digitalWrite(_settings->pinTransistorSwitch, LOW);
     pinMode(_settings->pinTransistorSwitch, INPUT);
     SPI.end();
+    if(powered){
+        PowerDomain::release(PERIPH_SPI);
+        CpuClock::releaseFull();
+    }
     _setPinsLow();
 }
 
 
 Dht22Data EpdDht22::readDht22(){
+    startReadout();
+    return finishReadout();
+}
+
+
+/**
+ * Starts sensor conversion. Anything can run until `finishReadout()`, which
+ * only waits for what is left of the conversion time.
+ */
+void EpdDht22::startReadout(){
+    _startSensor();
+
+    // the sensor sends the previous conversion and starts a new one, so read
+    // it to void first; a failure does not matter, so no retries
+    _dht22->read(1);
+    _readoutStarted = millis();
+    _readoutPending = true;
+}
 
-    // read DHT22 to void to clean buffer
-    _dht22->readTemperature();
-    _dht22->readHumidity();
 
-    delay(READ_DHT22_PAUSE);
+Dht22Data EpdDht22::finishReadout(){
+    if(!_readoutPending)
+        return *lastReading(0);
+
+    MemoryScope memory(MEMORY_READOUT);
+
+    unsigned long elapsed = millis() - _readoutStarted;
+    if(elapsed < _settings->config.readoutPause)
+        sleepFor(_settings->config.readoutPause - elapsed);
+    _readoutPending = false;
+
+    // all the sensors are read at once, failed ones are retried right away
+    // and pushed as empty samples, so the tiers keep their time alignment
+    _dht22->read();
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        Dht22Data _tmp = { 0., 0., 0 };
+        if(_dht22->status(i) == DHT22_OK){
+            _tmp.temperature = _dht22->temperature(i);
+            _tmp.humidity = _dht22->humidity(i);
+            _tmp.samples = 1;
+#ifdef SAMPLE_LOG
+            // the raw reading, before the spike filter
+            _log->append(persistentState.slotClock, i,
+                         toTenths(_tmp.temperature), toTenths(_tmp.humidity));
+#endif
+            _tmp = _filter(i, _tmp);
+            _freshSamples++;
+        }
+#ifdef SAMPLE_LOG
+        else
+            _log->append(persistentState.slotClock, i, LOG_NO_VALUE,
+                         LOG_NO_VALUE);
+#endif
+        _push(_fiveMinuteBuffer[i], NULL, _tmp);
+    }
+    _advance(FIVE_MIN_TIER, FIVE_MIN_BUFFER_SIZE);
 
-    Dht22Data _tmp = {
-        _dht22->readTemperature(),
-        _dht22->readHumidity()
-    };
+    return *lastReading(0);
+}
 
-    _fiveMinuteBuffer->push(_tmp);
 
-    return _tmp;
+Dht22Data *EpdDht22::lastReading(uint8_t sensor){
+    return _fiveMinuteBuffer[sensor]->last();
+}
+
+
+/**
+ * Whether a screen update would show anything new, there is no point to
+ * refresh the panel after failed readouts.
+ */
+bool EpdDht22::hasFreshSamples(){
+    return _freshSamples > 0;
 }
 
 
 Dht22Data EpdDht22::twentyMinuteAverage(){
-    Dht22Data _avg20min = _getAverageValues(_fiveMinuteBuffer);
-    _twentyMinuteBuffer->push(_avg20min);
-    return _avg20min;
+    // nothing to average yet (first wake), so take the pending sample now
+    if(_fiveMinuteBuffer[0]->size() == 0)
+        finishReadout();
+
+    // with a longer sample period the ring reaches back before the last
+    // average, only the readings since then belong to this one
+    TierIndex *source = &persistentState.tiers[FIVE_MIN_TIER];
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        Dht22Data _avg20min = _getAverageValues(_fiveMinuteBuffer[i],
+                                                source->fresh);
+        _push(_twentyMinuteBuffer[i], NULL, _avg20min);
+    }
+    source->fresh = 0;
+    _advance(TWENTY_MIN_TIER, TWENTY_MIN_BUFFER_SIZE);
+    return *_twentyMinuteBuffer[0]->last();
 }
 
 
 Dht22Data EpdDht22::twoHourAverage(){
-    Dht22Data _avg2h = _getAverageValues(_twentyMinuteBuffer);
-    _twoHourBuffer->push(_avg2h);
-    return _avg2h;
+    bool full = _twoHourBuffer[0]->size() == TWO_HOURS_BUFFER_SIZE;
+    TierIndex *source = &persistentState.tiers[TWENTY_MIN_TIER];
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        Dht22Data _avg2h = _getAverageValues(_twentyMinuteBuffer[i],
+                                             source->fresh);
+        _push(_twoHourBuffer[i], _twoHourStats[i], _avg2h);
+    }
+    source->fresh = 0;
+    _advance(TWO_HOUR_TIER, TWO_HOURS_BUFFER_SIZE);
+
+    // heights move with their samples, only the new one is scaled unless
+    // the axes changed
+    if(_updateAxis())
+        _scaleHistory(0);
+    else{
+        if(full){
+            memmove(_barHeights, _barHeights + 1, TWO_HOURS_BUFFER_SIZE - 1);
+            memmove(_humidityHeights, _humidityHeights + 1,
+                    TWO_HOURS_BUFFER_SIZE - 1);
+        }
+        _scaleHistory(_twoHourBuffer[0]->size() - 1);
+    }
+    return *_twoHourBuffer[0]->last();
 }
 
 
-void EpdDht22::_printHistory(){
+CircularArray<Dht22Data> *EpdDht22::history(Tier tier, uint8_t sensor){
+    if(tier == FIVE_MIN_TIER)
+        return _fiveMinuteBuffer[sensor];
+    if(tier == TWENTY_MIN_TIER)
+        return _twentyMinuteBuffer[sensor];
+    return _twoHourBuffer[sensor];
+}
 
-#ifdef DBG
-    _debugHistoryBuffer();
+
+#ifdef SAMPLE_LOG
+SampleLog *EpdDht22::sampleLog(){
+    return _log;
+}
 #endif
 
-    // get `min` & `max` values
-    MinMax minmax;
 
-    minmax.min = &_twoHourBuffer->get(0)->temperature;
-    minmax.max = &_twoHourBuffer->get(0)->temperature;
+// temperature trend by the slope of the two hour averages
+Trend EpdDht22::trend(uint8_t sensor){
+    int16_t slope = _twoHourStats[sensor]->slope();
+    int16_t threshold = _settings->config.trendThreshold;
+    if(slope >= threshold)
+        return rising;
+    if(slope <= -threshold)
+        return falling;
+    return steady;
+}
 
-    for(uint16_t i=1; i<_twoHourBuffer->size(); i++){
 
-        if(_twoHourBuffer->get(i)->temperature < *minmax.min)
-            minmax.min = &_twoHourBuffer->get(i)->temperature;
+// readings of the data widget, those of `showCurrent()` while it runs
+Dht22Data *EpdDht22::_shown(uint8_t sensor){
+    return _onDemand ? &_onDemand[sensor] : _twentyMinuteBuffer[sensor]->last();
+}
+
 
-        if(_twoHourBuffer->get(i)->temperature > *minmax.max)
-            minmax.max = &_twoHourBuffer->get(i)->temperature;
+/**
+ * Formats what a widget shows, once per render. Returns false when there is
+ * nothing to show, the panel keeps the previous content then.
+ */
+bool EpdDht22::_format(Widget widget, Labels *labels){
+    switch(widget){
+        case WIDGET_DATA:
+            for(uint8_t i=0; i<DHT22_SENSORS; i++){
+                Dht22Data *data = _shown(i);
+                if(!data->samples){
+                    strcpy(labels->data.temperature[i], "--");
+                    strcpy(labels->data.humidity[i], "--");
+                    continue;
+                }
+                formatFixed(labels->data.temperature[i],
+                            toTenths(data->temperature), 1, 1);
+                formatFixed(labels->data.humidity[i],
+                            toTenths(data->humidity), 1,
+                            DHT22_SENSORS == 1 ? 1 : 0);
+            }
+            return true;
+
+        case WIDGET_VCC:
+            formatFixed(labels->volts, _vcc ? _vcc : measureVcc(), 3, 2);
+            return true;
+
+        case WIDGET_HISTORY:
+            // no valid sample in the history
+            if(!_axis.intervals)
+                return false;
+            // half degree steps need the decimal place
+            for(uint8_t i=0; i<=_axis.intervals; i++)
+                formatFixed(labels->history.ticks[i],
+                            _axis.down + i * _axis.step, 1,
+                            _axis.step % 10 ? 1 : 0);
+            {
+                char *text = labels->history.humidity;
+                uint8_t length = formatFixed(text, _axis.humidityDown, 0, 0);
+                text[length++] = '-';
+                length += formatFixed(text + length, _axis.humidityUp, 0, 0);
+                strcpy(text + length, "%");
+            }
+            return true;
+
+        default:
+            return false;
     }
+}
 
-    // compute `up` and `down` ranges for y-axis
-    _range.down = floor(*minmax.min);
-    _range.up = ceil(*minmax.max);
-    _range.size = _range.up - _range.down;
 
-    // distance between x-ticks
-    float xPosDistance = (
-        (X_AXIS_WIDTH - X_AXIS_X) / (_twoHourBuffer->size() + 1)
-    );
+void EpdDht22::_draw(Widget widget, Adafruit_GFX *gfx, Labels *labels){
+    switch(widget){
+        case WIDGET_DATA:
+            _drawData(gfx, labels);
+            break;
+        case WIDGET_VCC:
+            _drawVcc(gfx, labels);
+            break;
+        case WIDGET_HISTORY:
+            _drawHistory(gfx, labels);
+            break;
+        default:
+            break;
+    }
+}
+
 
-    // number of y-ticks
-    uint16_t yNumberOfTicks = round(_range.size+1);
+/**
+ * Compares band hashes of a widget with the last frame and saves the new
+ * ones. Returns false when nothing changed, `window` covers the changed
+ * bands otherwise.
+ */
+bool EpdDht22::_changedWindow(Widget widget, FrameHash *frame,
+                              Window *window){
+    const Window *area = &WIDGET_WINDOWS[widget];
+    uint16_t *saved = _frameHashes[widget];
+    int8_t first = -1;
+    int8_t last = -1;
+
+    for(uint8_t band=0; band<frame->bands(); band++){
+        if(saved[band] == frame->hash(band))
+            continue;
+        saved[band] = frame->hash(band);
+        if(first < 0)
+            first = band;
+        last = band;
+    }
+    if(first < 0)
+        return false;
+
+    window->x = area->x;
+    window->w = area->w;
+    window->y = area->y + first * FRAME_BAND;
+    window->h = min((uint16_t)((last + 1) * FRAME_BAND), area->h) -
+                first * FRAME_BAND;
+    return true;
+}
 
-    // distance between y-ticks
-    uint16_t yPosDistance = round(GRAPH_HEIGHT / (yNumberOfTicks - 1));
 
-    // initialize eInk display
-    _display->setPartialWindow(GRAPH_X, GRAPH_Y - 10, GRAPH_WIDTH,
-                               GRAPH_HEIGHT + 10);
-    _display->setFont(&TomThumb);
-    _display->setTextColor(GxEPD_BLACK);
-    _display->firstPage();
+/**
+ * Formats a widget and finds the rows to send: its window, or the whole
+ * screen with a full refresh. The widget is drawn into a `FrameHash` and
+ * only rows which differ from the last frame are sent and refreshed;
+ * nothing at all when the widget did not change.
+ */
+void EpdDht22::_prepare(Widget widget, bool fullRefresh, Prepared *prepared){
+    prepared->send = false;
+    if(!_format(widget, &prepared->labels))
+        return;
+
+    // full refresh blanks the other widgets, they have to be sent again
+    if(fullRefresh)
+        memset(_frameHashes, 0, sizeof(_frameHashes));
+
+    FrameHash frame(&WIDGET_WINDOWS[widget]);
+    _draw(widget, &frame, &prepared->labels);
+    bool changed = _changedWindow(widget, &frame, &prepared->window);
+
+    if(fullRefresh)
+        prepared->window = { 0, 0, FRAME_WIDTH, FRAME_HEIGHT };
+    prepared->send = fullRefresh || changed;
+}
+
+
+void EpdDht22::_render(Widget widget, bool fullRefresh){
+    // memory phases are in the order of widgets
+    MemoryScope memory((MemoryPhase)(MEMORY_DATA + widget));
+
+    Prepared prepared;
+    _prepare(widget, fullRefresh, &prepared);
+    if(prepared.send)
+        _send(widget, &prepared.labels, &prepared.window, fullRefresh);
+}
 
+
+#ifdef EPD_FULL_FRAME
+/**
+ * Draws the window once into the frame buffer and sends it in one transfer.
+ * The controller diffs partial refreshes against its second RAM buffer,
+ * which gets the same bitmap after the refresh.
+ */
+void EpdDht22::_send(Widget widget, Labels *labels, Window *window,
+                     bool fullRefresh){
+    FrameBuffer::alignWindow(window);
+    FrameBuffer frame(window, frameBuffer);
+    frame.fillScreen(GxEPD_WHITE);
+    _draw(widget, &frame, labels);
+
+    _display->writeImage(frame.bitmap(), window->x, window->y, window->w,
+                         window->h);
+    if(fullRefresh)
+        _display->refresh(false);
+    else
+        _display->refresh(window->x, window->y, window->w, window->h);
+    _display->writeImage(frame.bitmap(), window->x, window->y, window->w,
+                         window->h);
+}
+#else
+// draws the window once per page of the driver buffer
+void EpdDht22::_send(Widget widget, Labels *labels, Window *window,
+                     bool fullRefresh){
+    if(fullRefresh)
+        _display->setFullWindow();
+    else
+        _display->setPartialWindow(window->x, window->y, window->w,
+                                   window->h);
+
+    _display->setRotation(0);
+    _display->firstPage();
     do {
+        _draw(widget, _display, labels);
+    }
+    while (_display->nextPage());
+}
+#endif
+
+
+void EpdDht22::_drawHistory(Adafruit_GFX *gfx, Labels *labels){
+    CircularArray<Dht22Data> *history = _twoHourBuffer[0];
 
-        // x-axis
-        _writeLine(X_AXIS_X, X_AXIS_Y, X_AXIS_WIDTH, X_AXIS_Y);
+    // distance between x-ticks
+    uint16_t xPosDistance = (
+        (X_AXIS_WIDTH - X_AXIS_X) / (history->size() + 1)
+    );
 
-        // y-axis
-        _writeLine(Y_AXIS_X, Y_AXIS_Y, Y_AXIS_X, Y_AXIS_Y - Y_AXIS_HEIGHT);
+    gfx->setFont(&TomThumb);
+    gfx->setTextColor(GxEPD_BLACK);
 
-        // x-ticks with bars, representing values
-        for(uint16_t i=0; i<_twoHourBuffer->size(); i++){
+    // x-axis
+    _writeLine(gfx, X_AXIS_X, X_AXIS_Y, X_AXIS_WIDTH, X_AXIS_Y);
 
-            float xPosition = (
-                X_AXIS_X + (i + 1) * xPosDistance
-            );
-            _writeLine(xPosition, X_AXIS_Y, xPosition, X_AXIS_Y + 3);
+    // y-axis
+    _writeLine(gfx, Y_AXIS_X, Y_AXIS_Y, Y_AXIS_X, Y_AXIS_Y - Y_AXIS_HEIGHT);
 
-            // print value bar
-            _drawBar(_twoHourBuffer->get(i)->temperature, xPosition);
-        }
+    // secondary y-axis of humidity
+    _writeLine(gfx, X_AXIS_WIDTH, Y_AXIS_Y, X_AXIS_WIDTH,
+               Y_AXIS_Y - Y_AXIS_HEIGHT);
 
-        // y-tics
-        for(uint16_t i=0; i<=yNumberOfTicks; i++){
-            uint16_t yPos = (X_AXIS_Y) - (i * yPosDistance);
-            _writeLine(X_AXIS_X, yPos, X_AXIS_X - 3, yPos);
-            _display->setCursor(X_AXIS_X - 20, yPos);
-            _display->print(_range.down + i);
+    // x-ticks with temperature bars and humidity points joined by a line,
+    // which breaks at missing samples
+    uint16_t lastX = 0;
+    uint16_t lastY = 0;
+    for(uint16_t i=0; i<history->size(); i++){
+
+        uint16_t xPosition = (
+            X_AXIS_X + (i + 1) * xPosDistance
+        );
+        _writeLine(gfx, xPosition, X_AXIS_Y, xPosition, X_AXIS_Y + 3);
+
+        if(!history->get(i)->samples){
+            lastX = 0;
+            continue;
         }
+        _drawBar(gfx, _barHeights[i], xPosition);
+
+        uint16_t yPosition = Y_AXIS_Y - _humidityHeights[i];
+        gfx->fillRect(xPosition - 1, yPosition - 1, 3, 3, GxEPD_BLACK);
+        if(lastX)
+            gfx->drawLine(lastX, lastY, xPosition, yPosition, GxEPD_BLACK);
+        lastX = xPosition;
+        lastY = yPosition;
+    }
 
+    // y-tics
+    for(uint8_t i=0; i<=_axis.intervals; i++){
+        uint16_t yPos = X_AXIS_Y - _axis.tickY[i];
+        _writeLine(gfx, X_AXIS_X, yPos, X_AXIS_X - 3, yPos);
+        gfx->setCursor(X_AXIS_X - 20, yPos);
+        gfx->print(labels->history.ticks[i]);
     }
-    while (_display->nextPage());
 
-    _display->powerOff();
+    // humidity tics, the range is printed above the axis
+    uint8_t steps = (_axis.humidityUp - _axis.humidityDown) / HUMIDITY_STEP;
+    for(uint8_t i=0; i<=steps; i++){
+        uint16_t yPos = Y_AXIS_Y - (uint16_t)i * GRAPH_HEIGHT / steps;
+        _writeLine(gfx, X_AXIS_WIDTH, yPos, X_AXIS_WIDTH + 3, yPos);
+    }
+    gfx->setCursor(X_AXIS_WIDTH - 4 * strlen(labels->history.humidity),
+                   Y_AXIS_Y - Y_AXIS_HEIGHT);
+    gfx->print(labels->history.humidity);
 }
 
 
-void EpdDht22::_printData(Dht22Data *data){
-
-    _display->setFullWindow();
-    _display->setRotation(0);
-    _display->setFont(&Georgia_weather18pt7b);
-    _display->setTextColor(GxEPD_BLACK);
-    _display->firstPage();
-    do
-    {
-      _display->fillScreen(GxEPD_WHITE);
-      _display->setCursor(MARGIN_LEFT, TEMPERATURES_TOP);
-      _display->print(THERMOMETER_100);
-      _display->setCursor(MARGIN_LEFT + 20, TEMPERATURES_TOP);
-      _display->print(data->temperature);
-      _display->print(" ");
-      _display->print(DEGREE_SIGN);
-      _display->println("C");
-      _display->setCursor(MARGIN_LEFT, TEMPERATURES_TOP + LINE);
-      _display->print(WATER_DROP);
-      _display->setCursor(MARGIN_LEFT + 20, TEMPERATURES_TOP + LINE);
-      _display->print(data->humidity);
-      _display->print(" ");
-      _display->print("%");
+void EpdDht22::_drawData(Adafruit_GFX *gfx, Labels *labels){
+    gfx->setFont(DHT22_SENSORS < 4 ? &Georgia_weather18pt7b : &TomThumb);
+    gfx->setTextColor(GxEPD_BLACK);
+    gfx->fillScreen(GxEPD_WHITE);
+
+#if DHT22_SENSORS == 1
+    _drawTrend(gfx, 0, MARGIN_LEFT - 15, TEMPERATURES_TOP - 10);
+    gfx->setCursor(MARGIN_LEFT, TEMPERATURES_TOP);
+    gfx->print(THERMOMETER_100);
+    gfx->setCursor(MARGIN_LEFT + 20, TEMPERATURES_TOP);
+    gfx->print(labels->data.temperature[0]);
+    gfx->print(" ");
+    gfx->print(DEGREE_SIGN);
+    gfx->println("C");
+    gfx->setCursor(MARGIN_LEFT, TEMPERATURES_TOP + LINE);
+    gfx->print(WATER_DROP);
+    gfx->setCursor(MARGIN_LEFT + 20, TEMPERATURES_TOP + LINE);
+    gfx->print(labels->data.humidity[0]);
+    gfx->print(" ");
+    gfx->print("%");
+#else
+    // one row per sensor with both values
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        uint16_t y = TEMPERATURES_TOP + i * SENSOR_ROW;
+        gfx->setCursor(5, y);
+        gfx->print(THERMOMETER_100);
+        gfx->setCursor(25, y);
+        gfx->print(labels->data.temperature[i]);
+        if(!_shown(i)->samples)
+            continue;
+        gfx->print(DEGREE_SIGN);
+        _drawTrend(gfx, i, 105, y - 5);
+        gfx->setCursor(120, y);
+        gfx->print(WATER_DROP);
+        gfx->setCursor(140, y);
+        gfx->print(labels->data.humidity[i]);
+        gfx->print("%");
     }
-    while (_display->nextPage());
+#endif
 }
 
 
-void EpdDht22::_printVcc(){
-    long vcc = 0;
-    for(uint16_t i=0; i<5; i++){
-        vcc += readVcc();
-        delay(100);
-    };
-    vcc = vcc / 5;
-    _display->setPartialWindow(0, 0, 50, 20);
-    _display->firstPage();
-    do{
-      _display->setFont(&Georgia_weather18pt7b);
-      _display->setTextColor(GxEPD_BLACK);
-      _display->setCursor(3, 13);
-      _display->print(BATTERY_100);
-      _display->print(F(" "));
-      _display->setCursor(30, 11);
-      _display->setTextColor(GxEPD_BLACK);
-      _display->setFont(&TomThumb);
-      _display->print(vcc / 1000.);
-      _display->print(F(" V"));
-    }
-    while (_display->nextPage());
+void EpdDht22::_drawVcc(Adafruit_GFX *gfx, Labels *labels){
+    gfx->setFont(&Georgia_weather18pt7b);
+    gfx->setTextColor(GxEPD_BLACK);
+    gfx->setCursor(3, 13);
+    gfx->print(BATTERY_100);
+    gfx->print(F(" "));
+    gfx->setCursor(30, 11);
+    gfx->setFont(&TomThumb);
+    gfx->print(labels->volts);
+    gfx->print(F(" V"));
 }
 
 
 void EpdDht22::printScreen(){
 #ifdef DBG
-    _debugDataBuffer();
+    {
+        PowerScope usart(PERIPH_USART);
+        _debugDataBuffer();
+        _debugHistoryBuffer();
+    }
 #endif
 
-    // print data
-    _printData(_twentyMinuteBuffer->last());
+    _freshSamples = 0;
+
+    // full refresh every n-th update and whenever the panel was powered up,
+    // partial otherwise
+    bool fullRefresh = (_screenUpdates == 0) || _displayBlank;
+    if(++_screenUpdates >= profile()->fullRefreshPeriod)
+        _screenUpdates = 0;
+    _update(fullRefresh);
+}
+
+
+// renders all the widgets, the first one with `fullRefresh` if set
+void EpdDht22::_update(bool fullRefresh){
+    _render(WIDGET_DATA, fullRefresh);
+    _render(WIDGET_VCC, false);
+    _render(WIDGET_HISTORY, false);
+
+    if(fullRefresh)
+        _displayBlank = false;
+    _display->powerOff();
+}
 
-    // printVcc
-    _printVcc();
 
-    // print history graph
-    _printHistory();
+/**
+ * Readings of this moment in the data widget, between the scheduled wakes.
+ * Nothing goes to the tiers or the log, the next scheduled screen shows the
+ * averages again. The panel powers up while the sensor converts.
+ */
+void EpdDht22::showCurrent(){
+    startReadout();
+    _readoutPending = false;
+    powerUp();
+    unsigned long elapsed = millis() - _readoutStarted;
+    if(elapsed < _settings->config.readoutPause)
+        sleepFor(_settings->config.readoutPause - elapsed);
+
+    // a failed sensor keeps its average, all of them failing changes nothing
+    Dht22Data current[DHT22_SENSORS];
+    bool fresh = false;
+    _dht22->read();
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        current[i] = *_twentyMinuteBuffer[i]->last();
+        if(_dht22->status(i) != DHT22_OK)
+            continue;
+        current[i].temperature = _dht22->temperature(i);
+        current[i].humidity = _dht22->humidity(i);
+        current[i].samples = 1;
+        fresh = true;
+    }
+
+    // the power-up blanked the controller, so the whole screen is sent
+    if(fresh){
+        _onDemand = current;
+        _update(_displayBlank);
+        _onDemand = NULL;
+    }
+    powerDown();
 }
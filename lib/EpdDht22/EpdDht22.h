@@ -1,9 +1,19 @@
 #include <Arduino.h>
-#include <DHT.h>
 #include <GxEPD2_AVR_BW.h>
 #include "CircularArray.h"
+#include "Dht22.h"
+#include "TierStats.h"
+#include "FixedFormat.h"
+#include "SampleLog.h"
+#include "FrameBuffer.h"
+#include "Config.h"
 
-#define DHT_TYPE DHT22
+/**
+ * Frame buffer policy. By default the driver renders in pages and each
+ * widget is drawn once per page. With `EPD_FULL_FRAME` it is drawn once into
+ * a RAM bitmap of the whole screen and sent in a single transfer; the
+ * 5000 bytes of it fit on a 1284P or 2560, not on the 328.
+ */
 
 // weather font
 #define BATTERY_100 '!'
@@ -19,6 +29,27 @@ const uint8_t FIVE_MIN_BUFFER_SIZE = 4;
 const uint8_t TWENTY_MIN_BUFFER_SIZE = 6;
 const uint8_t TWO_HOURS_BUFFER_SIZE = 12;
 
+// slots of a 20 min and of a 2 hour average, the buffers are sized by them
+const uint8_t AVERAGE_SLOTS = FIVE_MIN_BUFFER_SIZE;
+const uint8_t HISTORY_SLOTS = FIVE_MIN_BUFFER_SIZE * TWENTY_MIN_BUFFER_SIZE;
+
+// valid readings the spike filter takes the median of
+const uint8_t MEDIAN_WINDOW = 3;
+
+// defaults of `Config`
+
+// pause between DHT22 readouts in ms
+const uint16_t READ_DHT22_PAUSE = 2500;
+
+// two hour slope of temperature shown as rising or falling, in hundredths
+// of degree per 2 hours
+const uint16_t TREND_THRESHOLD = 25;
+
+// supply voltage thresholds for power profiles in mV
+const uint16_t VCC_SAVER = 3000;
+const uint16_t VCC_CRITICAL = 2800;
+const uint16_t VCC_HYSTERESIS = 100;
+
 
 enum Envinroment {
     development,
@@ -27,72 +58,268 @@ enum Envinroment {
 };
 
 
+enum PowerProfile {
+    normal,
+    saver,
+    critical
+};
+
+
+// parts of the screen, each is rendered and refreshed on its own
+enum Widget {
+    WIDGET_DATA,
+    WIDGET_VCC,
+    WIDGET_HISTORY,
+    WIDGETS
+};
+
+
+enum Trend {
+    falling,
+    steady,
+    rising
+};
+
+
+/**
+ * Periods are counted in 5 minute slots, so they have to divide the 20 minute
+ * (4 slots) and 2 hour (24 slots) boundaries.
+ */
+struct ProfileSettings {
+    uint8_t samplePeriod;       // slots between sensor readouts
+    uint8_t screenPeriod;       // slots between screen updates
+    uint8_t fullRefreshPeriod;  // screen updates between full refreshes
+    bool serialLog;
+};
+
+// indexed by `PowerProfile`, `Config` sets the screen cadence of normal
+extern const ProfileSettings POWER_PROFILES[];
+
+
 struct Settings {
-    uint8_t pinDht22;
+    uint8_t pinDht22[DHT22_SENSORS];    // all on the port of the first one
     uint8_t pinTransistorSwitch;
     uint8_t envin;
+    uint8_t pinEpdBusy;
+    Config config;              // defaults until the EEPROM record is loaded
 };
 
 
 struct Dht22Data {
     float temperature;
     float humidity;
+    uint8_t samples;    // valid readings behind the values, 0 for none
+};
+
+
+// most intervals between y-ticks of the history graph
+const uint8_t AXIS_MAX_INTERVALS = 6;
+
+// ticks of the humidity axis of the history graph in percent
+const uint8_t HUMIDITY_STEP = 10;
+
+
+/**
+ * Y-axes of the history graph, temperature in tenths of degree and humidity
+ * on the secondary one in percent. They are recomputed when history
+ * changes, `intervals` is 0 when there is nothing to show.
+ */
+struct Axis {
+    int16_t down;
+    int16_t step;
+    uint8_t intervals;
+    uint8_t tickY[AXIS_MAX_INTERVALS + 1];    // pixels above the x-axis
+    uint8_t humidityDown;
+    uint8_t humidityUp;
+};
+
+
+enum Tier {
+    FIVE_MIN_TIER,
+    TWENTY_MIN_TIER,
+    TWO_HOUR_TIER,
+    TIERS
+};
+
+
+// ring position of a tier, the same for all the sensors
+struct TierIndex {
+    uint8_t head;
+    uint8_t count;
+    uint8_t fresh;      // pushed since the next tier averaged them
+};
+
+
+// text of a widget, formatted once per render and drawn on every page
+union Labels {
+    struct {
+        FixedText temperature[DHT22_SENSORS];
+        FixedText humidity[DHT22_SENSORS];
+    } data;
+    FixedText volts;
+    struct {
+        FixedText ticks[AXIS_MAX_INTERVALS + 1];
+        FixedText humidity;     // range of the secondary axis
+    } history;
 };
 
 
-struct MinMax {
-    float *min;
-    float *max;
+// widget ready to be sent
+struct Prepared {
+    Labels labels;
+    Window window;      // rows to send
+    bool send;          // false when the panel shows it already
 };
 
 
-struct Range {
-    float down;
-    float up;
-    float size;
+/**
+ * Everything needed to continue after a watchdog, brown-out or external
+ * reset. It lives in `.noinit` RAM, which is not cleared by the C runtime,
+ * and is protected by a CRC.
+ */
+struct PersistentState {
+    uint16_t magic;
+    Dht22Data fiveMinute[DHT22_SENSORS][FIVE_MIN_BUFFER_SIZE];
+    Dht22Data twentyMinute[DHT22_SENSORS][TWENTY_MIN_BUFFER_SIZE];
+    Dht22Data twoHour[DHT22_SENSORS][TWO_HOURS_BUFFER_SIZE];
+    TierIndex tiers[TIERS];
+    // last valid readings per sensor for the spike filter, oldest first
+    Dht22Data recent[DHT22_SENSORS][MEDIAN_WINDOW];
+    uint8_t recentCount[DHT22_SENSORS];
+    uint8_t numberOfWakes;
+    uint32_t slotClock;     // slots since power-on
+    uint16_t crc;
 };
 
+extern PersistentState persistentState;
+
+// MCUSR as it was at reset
+extern uint8_t resetFlags;
+
+bool persistentStateValid();
+void persistentStateReset();
+void persistentStateSeal();
+
 
 class EpdDht22 {
+#ifdef BENCH
+    // benchmark firmware in bench/ times the private parts
+    friend class Bench;
+#endif
     private:
         Settings *_settings;
-        DHT *_dht22;
+        Dht22 *_dht22;
+#ifdef SAMPLE_LOG
+        SampleLog *_log;
+#endif
         GxEPD2_AVR_BW *_display;
 
+        // buffers per sensor over `persistentState`, history graph shows
+        // the first one
+
         // 5 minutes buffer
-        Dht22Data _fmb[FIVE_MIN_BUFFER_SIZE];
-        CircularArray<Dht22Data> *_fiveMinuteBuffer;
+        CircularArray<Dht22Data> *_fiveMinuteBuffer[DHT22_SENSORS];
 
         // 20 minutes buffer
-        Dht22Data _tmb[TWENTY_MIN_BUFFER_SIZE];
-        CircularArray<Dht22Data> *_twentyMinuteBuffer;
+        CircularArray<Dht22Data> *_twentyMinuteBuffer[DHT22_SENSORS];
 
         // 2 hours buffer (or 24 hours history)
-        Dht22Data _2hb[TWO_HOURS_BUFFER_SIZE];
-        CircularArray<Dht22Data> *_twoHourBuffer;
+        CircularArray<Dht22Data> *_twoHourBuffer[DHT22_SENSORS];
+
+        // temperature statistics of the two hour tier, axis and trend
+        TierStats *_twoHourStats[DHT22_SENSORS];
+
+        Axis _axis;
+
+        // pixels above the x-axis of the first sensor's two hour tier,
+        // oldest first; scaled once on push and again when the axes change
+        uint8_t _barHeights[TWO_HOURS_BUFFER_SIZE];
+        uint8_t _humidityHeights[TWO_HOURS_BUFFER_SIZE];
+
+        // controller RAM was cleared since the last full refresh
+        bool _displayBlank;
+        bool _displayPowered;
+        bool _restored;
 
-        // TODO: get rid of this variable
-        Range _range;
+        // readout started by `startReadout()`
+        bool _readoutPending;
+        unsigned long _readoutStarted;
+
+        // averaged supply voltage of the current wake in mV
+        long _vcc;
+
+        // band hashes of the frame on the panel per widget
+        uint16_t _frameHashes[WIDGETS][FRAME_MAX_BANDS];
+
+        PowerProfile _profile;
+        ProfileSettings _profileSettings;   // with the cadence of `Config`
+        uint8_t _screenUpdates;
+
+        // valid readings since the last `printScreen()`
+        uint8_t _freshSamples;
+
+        // readings of `showCurrent()` shown instead of the 20 min averages
+        Dht22Data *_onDemand;
 
         void _setPinsLow();
+        void _startSensor();
+        void _restoreBuffer(CircularArray<Dht22Data> *buffer, TierStats *stats,
+                            Dht22Data *data, uint8_t capacity,
+                            TierIndex *index);
+        void _push(CircularArray<Dht22Data> *buffer, TierStats *stats,
+                   Dht22Data value);
+        void _advance(Tier tier, uint8_t capacity);
+        bool _updateAxis();
+        void _scaleHistory(uint8_t first);
+        Dht22Data _filter(uint8_t sensor, Dht22Data sample);
         void _debugDataBuffer();
         void _debugHistoryBuffer();
 
-        Dht22Data _getAverageValues(CircularArray<Dht22Data> *buffer);
+        Dht22Data _getAverageValues(CircularArray<Dht22Data> *buffer,
+                                    uint8_t newest);
+
+        // rendering
+        Dht22Data *_shown(uint8_t sensor);
+        bool _format(Widget widget, Labels *labels);
+        void _draw(Widget widget, Adafruit_GFX *gfx, Labels *labels);
+        bool _changedWindow(Widget widget, FrameHash *frame, Window *window);
+        void _prepare(Widget widget, bool fullRefresh, Prepared *prepared);
+        void _render(Widget widget, bool fullRefresh);
+        void _update(bool fullRefresh);
+        void _send(Widget widget, Labels *labels, Window *window,
+                   bool fullRefresh);
 
         // graph functions
-        void _writeLine(uint16_t, uint16_t, uint16_t, uint16_t);
-        void _drawBar(float value, uint16_t xPos);
-        void _printData(Dht22Data *data);
-        void _printHistory();
-        void _printVcc();
+        void _writeLine(Adafruit_GFX *gfx, uint16_t, uint16_t, uint16_t,
+                        uint16_t);
+        void _drawBar(Adafruit_GFX *gfx, uint8_t height, uint16_t xPos);
+        void _drawTrend(Adafruit_GFX *gfx, uint8_t sensor, uint16_t x,
+                        uint16_t y);
+        void _drawData(Adafruit_GFX *gfx, Labels *labels);
+        void _drawHistory(Adafruit_GFX *gfx, Labels *labels);
+        void _drawVcc(Adafruit_GFX *gfx, Labels *labels);
     public:
         EpdDht22(Settings *settings);
+        bool restored();
+        Settings *settings();
         void powerUp();
         void powerDown();
         Dht22Data readDht22();
+        void startReadout();
+        Dht22Data finishReadout();
+        Dht22Data *lastReading(uint8_t sensor);
+        bool hasFreshSamples();
         Dht22Data twentyMinuteAverage();
         Dht22Data twoHourAverage();
+        CircularArray<Dht22Data> *history(Tier tier, uint8_t sensor);
+#ifdef SAMPLE_LOG
+        SampleLog *sampleLog();
+#endif
+        Trend trend(uint8_t sensor);
         void printScreen();
+        void showCurrent();
         long readVcc();
+        long measureVcc();
+        PowerProfile updatePowerProfile();
+        const ProfileSettings *profile();
 };
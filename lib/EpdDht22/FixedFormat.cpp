@@ -0,0 +1,36 @@
+#include "FixedFormat.h"
+
+
+// returns length of the text
+uint8_t formatFixed(char *buffer, int16_t value, uint8_t scale,
+                    uint8_t decimals){
+    bool negative = value < 0;
+    uint16_t magnitude = negative ? -(int32_t)value : value;
+
+    // drop the places which are not shown
+    uint16_t divisor = 1;
+    for(uint8_t i=decimals; i<scale; i++)
+        divisor *= 10;
+    magnitude = (magnitude + divisor / 2) / divisor;
+    if(!magnitude)
+        negative = false;
+
+    // digits from the lowest one, at least one before the point
+    char digits[FIXED_SIZE];
+    uint8_t count = 0;
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude || count <= decimals);
+
+    uint8_t length = 0;
+    if(negative)
+        buffer[length++] = '-';
+    while(count){
+        if(count == decimals)
+            buffer[length++] = '.';
+        buffer[length++] = digits[--count];
+    }
+    buffer[length] = 0;
+    return length;
+}
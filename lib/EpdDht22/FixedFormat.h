@@ -0,0 +1,17 @@
+#include <Arduino.h>
+
+/**
+ * Text of fixed-point numbers without `Print::print(double)`.
+ *
+ * A value is an integer scaled by 10^scale (tenths of degree: scale 1,
+ * millivolts as volts: scale 3). It is written with `decimals` places,
+ * which can not be more than `scale`, rounded half away from zero.
+ */
+
+// longest text with sign, point and terminator, scale up to 4
+#define FIXED_SIZE 8
+
+typedef char FixedText[FIXED_SIZE];
+
+uint8_t formatFixed(char *buffer, int16_t value, uint8_t scale,
+                    uint8_t decimals);
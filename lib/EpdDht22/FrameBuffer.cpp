@@ -0,0 +1,78 @@
+#include "FrameBuffer.h"
+
+
+FrameBuffer::FrameBuffer(const Window *window, uint8_t *bitmap) :
+        Adafruit_GFX(FRAME_WIDTH, FRAME_HEIGHT){
+    _window = window;
+    _bitmap = bitmap;
+    _stride = (window->w + 7) / 8;
+}
+
+
+// the controller addresses whole bytes of a row
+void FrameBuffer::alignWindow(Window *window){
+    window->w += window->x % 8;
+    window->x -= window->x % 8;
+    window->w = (window->w + 7) & ~7;
+}
+
+
+uint8_t *FrameBuffer::bitmap(){
+    return _bitmap;
+}
+
+
+void FrameBuffer::drawPixel(int16_t x, int16_t y, uint16_t color){
+    x -= _window->x;
+    y -= _window->y;
+    if(x < 0 || y < 0 || x >= (int16_t)_window->w || y >= (int16_t)_window->h)
+        return;
+
+    uint8_t *byte = &_bitmap[y * _stride + x / 8];
+    if(color)
+        *byte |= 0x80 >> (x % 8);
+    else
+        *byte &= ~(0x80 >> (x % 8));
+}
+
+
+/**
+ * Fills whole bytes of the row at once, only the partial bytes at both
+ * ends go through masks.
+ */
+void FrameBuffer::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                uint16_t color){
+    int16_t left = max(x, (int16_t)_window->x) - _window->x;
+    int16_t right = min(x + w, (int16_t)(_window->x + _window->w)) -
+                    _window->x;
+    y -= _window->y;
+    if(left >= right || y < 0 || y >= (int16_t)_window->h)
+        return;
+
+    uint8_t *row = &_bitmap[y * _stride];
+    for(int16_t i=left; i<right; ){
+        uint8_t mask = 0xFF >> (i % 8);
+        int16_t next = (i & ~7) + 8;
+        if(next > right){
+            mask &= 0xFF << (next - right);
+            next = right;
+        }
+        if(color)
+            row[i / 8] |= mask;
+        else
+            row[i / 8] &= ~mask;
+        i = next;
+    }
+}
+
+
+void FrameBuffer::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                           uint16_t color){
+    for(int16_t i=y; i<y + h; i++)
+        drawFastHLine(x, i, w, color);
+}
+
+
+void FrameBuffer::fillScreen(uint16_t color){
+    memset(_bitmap, color ? 0xFF : 0x00, _stride * _window->h);
+}
@@ -0,0 +1,32 @@
+#include "FrameHash.h"
+
+/**
+ * Graphics target which draws a window into a 1 bit RAM bitmap, in the
+ * layout `GxEPD2_AVR_BW::writeImage()` expects: rows of whole bytes, most
+ * significant bit left, set bits white.
+ *
+ * Used instead of paged rendering with `EPD_FULL_FRAME`, a widget is then
+ * drawn once and sent in a single transfer. The window has to start at a
+ * multiple of 8 columns, see `alignWindow()`.
+ */
+
+// bitmap of the whole screen
+#define FRAME_BUFFER_SIZE (FRAME_WIDTH / 8 * FRAME_HEIGHT)
+
+
+class FrameBuffer : public Adafruit_GFX {
+    private:
+        const Window *_window;
+        uint8_t *_bitmap;
+        uint8_t _stride;
+    public:
+        FrameBuffer(const Window *window, uint8_t *bitmap);
+        static void alignWindow(Window *window);
+        uint8_t *bitmap();
+
+        void drawPixel(int16_t x, int16_t y, uint16_t color);
+        void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+        void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color);
+        void fillScreen(uint16_t color);
+};
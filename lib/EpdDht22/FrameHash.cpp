@@ -0,0 +1,75 @@
+#include "FrameHash.h"
+
+
+FrameHash::FrameHash(const Window *window) :
+        Adafruit_GFX(FRAME_WIDTH, FRAME_HEIGHT){
+    _window = window;
+    for(uint8_t i=0; i<FRAME_MAX_BANDS; i++)
+        _hash[i] = FRAME_HASH_SEED;
+}
+
+
+uint8_t FrameHash::bands(){
+    return (_window->h + FRAME_BAND - 1) / FRAME_BAND;
+}
+
+
+uint16_t FrameHash::hash(uint8_t band){
+    return _hash[band];
+}
+
+
+/**
+ * Clips a filled rectangle to the window and mixes its part in each band
+ * into that band's hash, in coordinates relative to the band.
+ */
+void FrameHash::_mix(int16_t x, int16_t y, int16_t w, int16_t h,
+                     uint16_t color){
+    int16_t left = max(x, (int16_t)_window->x);
+    int16_t right = min(x + w, (int16_t)(_window->x + _window->w));
+    int16_t top = max(y, (int16_t)_window->y);
+    int16_t bottom = min(y + h, (int16_t)(_window->y + _window->h));
+    if(left >= right || top >= bottom)
+        return;
+
+    top -= _window->y;
+    bottom -= _window->y;
+    for(uint8_t band = top / FRAME_BAND; band * FRAME_BAND < bottom; band++){
+        int16_t bandTop = band * FRAME_BAND;
+        uint16_t rows = ((max(top, bandTop) - bandTop) << 4) |
+                        (min(bottom, (int16_t)(bandTop + FRAME_BAND)) - bandTop);
+        uint16_t *hash = &_hash[band];
+        *hash = (*hash << 5) + *hash + left;
+        *hash = (*hash << 5) + *hash + right;
+        *hash = (*hash << 5) + *hash + rows;
+        *hash = (*hash << 5) + *hash + (color ? 1 : 0);
+    }
+}
+
+
+void FrameHash::drawPixel(int16_t x, int16_t y, uint16_t color){
+    _mix(x, y, 1, 1, color);
+}
+
+
+void FrameHash::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                              uint16_t color){
+    _mix(x, y, w, 1, color);
+}
+
+
+void FrameHash::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                              uint16_t color){
+    _mix(x, y, 1, h, color);
+}
+
+
+void FrameHash::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                         uint16_t color){
+    _mix(x, y, w, h, color);
+}
+
+
+void FrameHash::fillScreen(uint16_t color){
+    _mix(0, 0, FRAME_WIDTH, FRAME_HEIGHT, color);
+}
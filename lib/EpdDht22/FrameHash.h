@@ -0,0 +1,49 @@
+#include <Adafruit_GFX.h>
+
+/**
+ * Graphics target which draws nothing and hashes what would be drawn into
+ * a window, per band of FRAME_BAND rows.
+ *
+ * A widget is drawn into it first; bands whose hash differs from the last
+ * frame give the rows which have to be sent and refreshed. Rectangles and
+ * lines are hashed by their parameters, not pixel by pixel, so the pass
+ * costs about as much as drawing one page.
+ */
+
+#define FRAME_WIDTH 200
+#define FRAME_HEIGHT 200
+#define FRAME_BAND 8
+
+// bands of the highest window
+#define FRAME_MAX_BANDS 13
+
+// empty band, never equal to an unset saved hash
+#define FRAME_HASH_SEED 5381
+
+
+struct Window {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+};
+
+
+class FrameHash : public Adafruit_GFX {
+    private:
+        const Window *_window;
+        uint16_t _hash[FRAME_MAX_BANDS];
+
+        void _mix(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    public:
+        FrameHash(const Window *window);
+        uint8_t bands();
+        uint16_t hash(uint8_t band);
+
+        void drawPixel(int16_t x, int16_t y, uint16_t color);
+        void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+        void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+        void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color);
+        void fillScreen(uint16_t color);
+};
@@ -0,0 +1,150 @@
+#include "LogDevice.h"
+#include "PowerDomain.h"
+#include "CpuClock.h"
+#include "BusyWait.h"
+#include <SPI.h>
+
+#define CMD_WRITE_ENABLE 0x06
+#define CMD_READ_STATUS 0x05
+#define CMD_READ 0x03
+#define CMD_PROGRAM 0x02
+#define CMD_ERASE_SECTOR 0x20
+#define CMD_SLEEP 0xB9
+#define CMD_WAKE 0xAB
+
+#define STATUS_BUSY 0x01
+
+// wake-up from deep power-down (NOR) or sleep (FRAM) in us
+#define WAKE_US 450
+
+static const SPISettings LOG_SPI(4000000, MSBFIRST, SPI_MODE0);
+
+uint8_t LogDevice::_railPin = NOT_A_PIN;
+const uint16_t *LogDevice::_railSettle = NULL;
+bool LogDevice::_railed = false;
+
+
+void LogDevice::_select(uint8_t command, uint32_t address){
+    digitalWrite(LOG_CS_PIN, LOW);
+    SPI.transfer(command);
+    for(int8_t i=LOG_ADDRESS_BYTES - 1; i>=0; i--)
+        SPI.transfer(address >> (8 * i));
+}
+
+
+void LogDevice::_command(uint8_t command){
+    digitalWrite(LOG_CS_PIN, LOW);
+    SPI.transfer(command);
+    digitalWrite(LOG_CS_PIN, HIGH);
+}
+
+
+// FRAM writes at bus speed, its status never shows busy
+void LogDevice::_waitReady(){
+    digitalWrite(LOG_CS_PIN, LOW);
+    SPI.transfer(CMD_READ_STATUS);
+    while(SPI.transfer(0) & STATUS_BUSY)
+        ;
+    digitalWrite(LOG_CS_PIN, HIGH);
+}
+
+
+/**
+ * Power switch of the panel and its settle time in ms. SCK, MOSI and the
+ * panel CS are shared, driving them into an unpowered panel would feed it
+ * through its pins, so the panel is switched on while the log uses the bus
+ * alone.
+ */
+void LogDevice::panelRail(uint8_t pin, const uint16_t *settle){
+    _railPin = pin;
+    _railSettle = settle;
+}
+
+
+/**
+ * Wakes the chip, it sleeps between the batches. Nested with the display
+ * the bus is already up, `SPI.begin()` does not mind.
+ */
+void LogDevice::begin(){
+    // the display holds the SPI domain while the panel is powered
+    if(!_railed && _railPin != NOT_A_PIN &&
+       !PowerDomain::enabled(PERIPH_SPI)){
+        pinMode(_railPin, OUTPUT);
+        digitalWrite(_railPin, HIGH);
+        sleepFor(*_railSettle);
+        _railed = true;
+    }
+
+    PowerDomain::acquire(PERIPH_SPI);
+    CpuClock::acquireFull();
+    digitalWrite(LOG_CS_PIN, HIGH);
+    pinMode(LOG_CS_PIN, OUTPUT);
+    SPI.begin();
+    SPI.beginTransaction(LOG_SPI);
+
+    // FRAM wakes on the falling edge of CS, the command is ignored
+    _command(CMD_WAKE);
+    delayMicroseconds(WAKE_US);
+}
+
+
+void LogDevice::end(){
+    _command(CMD_SLEEP);
+    SPI.endTransaction();
+    SPI.end();
+    // idles deselected by the pull-up, also while the bus is down
+    pinMode(LOG_CS_PIN, INPUT_PULLUP);
+    CpuClock::releaseFull();
+    PowerDomain::release(PERIPH_SPI);
+
+    // nobody else on the bus, the display must not be driven once its
+    // power is cut
+    if(!PowerDomain::enabled(PERIPH_SPI)){
+        pinMode(SCK, INPUT);
+        pinMode(MOSI, INPUT);
+        pinMode(SS, INPUT);
+        if(_railed){
+            digitalWrite(_railPin, LOW);
+            pinMode(_railPin, INPUT);
+            _railed = false;
+        }
+    }
+}
+
+
+void LogDevice::read(uint32_t address, void *data, uint16_t length){
+    uint8_t *bytes = (uint8_t *)data;
+    _select(CMD_READ, address);
+    for(uint16_t i=0; i<length; i++)
+        bytes[i] = SPI.transfer(0);
+    digitalWrite(LOG_CS_PIN, HIGH);
+}
+
+
+// `length` bytes within one page
+void LogDevice::program(uint32_t address, const void *data, uint16_t length){
+    const uint8_t *bytes = (const uint8_t *)data;
+    _command(CMD_WRITE_ENABLE);
+    _select(CMD_PROGRAM, address);
+    for(uint16_t i=0; i<length; i++)
+        SPI.transfer(bytes[i]);
+    digitalWrite(LOG_CS_PIN, HIGH);
+    _waitReady();
+}
+
+
+// sector which contains `address`
+void LogDevice::erase(uint32_t address){
+    address -= address % LOG_SECTOR_SIZE;
+#ifdef LOG_FRAM
+    uint8_t erased[LOG_PAGE_SIZE / 8];
+    memset(erased, 0xFF, sizeof(erased));
+    for(uint16_t i=0; i<LOG_SECTOR_SIZE; i+=sizeof(erased))
+        program(address + i, erased, sizeof(erased));
+#else
+    _command(CMD_WRITE_ENABLE);
+    _select(CMD_ERASE_SECTOR, address);
+    digitalWrite(LOG_CS_PIN, HIGH);
+    _waitReady();
+#endif
+}
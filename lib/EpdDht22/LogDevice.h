@@ -0,0 +1,65 @@
+#include <Arduino.h>
+
+/**
+ * SPI memory of the sample log, on the display's bus with its own CS pin.
+ *
+ * NOR flash by default (W25Q80 and alike): pages are programmed without
+ * crossing a page boundary and only after the sector was erased. With
+ * LOG_FRAM the same interface drives an FRAM (MB85RS and alike), which
+ * writes in place; erase then fills the sector with 0xFF, so the log sees
+ * the same erased state on both. The simulator replaces this file with a
+ * file-backed stand-in, sim/LogDeviceFile.cpp.
+ */
+
+// A0 of the board, Pins.h checks that no sensor is on it
+#ifndef LOG_CS_PIN
+#ifdef __AVR_ATmega1284P__
+#define LOG_CS_PIN 24   // PA0 on the MightyCore standard pinout
+#else
+#define LOG_CS_PIN 14
+#endif
+#endif
+
+#ifdef LOG_FRAM
+#ifndef LOG_SIZE
+#define LOG_SIZE 32768UL    // 256 kbit
+#endif
+#define LOG_ADDRESS_BYTES 2
+#else
+#ifndef LOG_SIZE
+#define LOG_SIZE 1048576UL  // 8 Mbit
+#endif
+#define LOG_ADDRESS_BYTES 3
+#endif
+
+#define LOG_PAGE_SIZE 256
+#define LOG_SECTOR_SIZE 4096
+#define LOG_SECTORS (LOG_SIZE / LOG_SECTOR_SIZE)
+
+
+class LogDevice {
+    private:
+        static uint8_t _railPin;
+        static const uint16_t *_railSettle;
+        static bool _railed;
+
+        static void _select(uint8_t command, uint32_t address);
+        static void _command(uint8_t command);
+        static void _waitReady();
+    public:
+        static void panelRail(uint8_t pin, const uint16_t *settle);
+        static void begin();
+        static void end();
+        static void read(uint32_t address, void *data, uint16_t length);
+        static void program(uint32_t address, const void *data,
+                            uint16_t length);
+        static void erase(uint32_t address);
+};
+
+
+// SPI bus and the chip awake for the lifetime of the scope
+class LogScope {
+    public:
+        LogScope(){ LogDevice::begin(); }
+        ~LogScope(){ LogDevice::end(); }
+};
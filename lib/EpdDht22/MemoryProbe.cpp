@@ -0,0 +1,109 @@
+#include "MemoryProbe.h"
+#include "PowerDomain.h"
+
+// RAM nobody wrote to since it was painted
+#define STACK_CANARY 0xC5
+
+// bytes below the stack pointer left alone when a phase repaints
+#define PAINT_MARGIN 16
+
+uint16_t MemoryProbe::_minFree[MEMORY_PHASES];
+uint8_t MemoryProbe::_measured = 0;
+
+
+#ifdef __AVR__
+extern char *__brkval;
+extern char __heap_start;
+
+
+/**
+ * Paints everything between the end of static data (`.noinit` included)
+ * and the top of RAM. Runs before the stack pointer is set up, so there is
+ * no C in it.
+ */
+void paintStack() __attribute__((naked, used, section(".init1")));
+void paintStack(){
+    __asm volatile(
+        "    ldi r30, lo8(_end)\n"
+        "    ldi r31, hi8(_end)\n"
+        "    ldi r24, %0\n"
+        "    ldi r25, hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:  st Z+, r24\n"
+        "2:  cpi r30, lo8(__stack)\n"
+        "    cpc r31, r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n"
+        :: "M" (STACK_CANARY));
+}
+
+
+static uint8_t *_heapEnd(){
+    return (uint8_t *)(__brkval ? __brkval : &__heap_start);
+}
+
+
+// painted bytes above the heap nobody has touched
+static uint16_t _untouched(){
+    uint8_t *heap = _heapEnd();
+    uint16_t gap = SP - (uint16_t)heap;
+    uint16_t n = 0;
+    while(n < gap && heap[n] == STACK_CANARY)
+        n++;
+    return n;
+}
+#endif
+
+
+// RAM between the heap and the stack right now
+uint16_t MemoryProbe::freeRam(){
+#ifdef __AVR__
+    return SP - (uint16_t)_heapEnd();
+#else
+    return 0;
+#endif
+}
+
+
+void MemoryProbe::begin(MemoryPhase phase){
+#ifdef __AVR__
+    uint8_t *p = _heapEnd();
+    uint8_t *limit = (uint8_t *)SP - PAINT_MARGIN;
+    while(p < limit)
+        *p++ = STACK_CANARY;
+#endif
+}
+
+
+void MemoryProbe::end(MemoryPhase phase){
+#ifdef __AVR__
+    uint16_t untouched = _untouched();
+#else
+    uint16_t untouched = 0;
+#endif
+    if(!(_measured & bit(phase)) || untouched < _minFree[phase])
+        _minFree[phase] = untouched;
+    _measured |= bit(phase);
+}
+
+
+uint16_t MemoryProbe::minFree(MemoryPhase phase){
+    return (_measured & bit(phase)) ? _minFree[phase] : freeRam();
+}
+
+
+void MemoryProbe::report(){
+    PowerScope usart(PERIPH_USART);
+    Serial.print(F("free RAM: "));
+    Serial.print(freeRam());
+    Serial.print(F(", least per phase (setup, readout, data, vcc, "
+                   "history):"));
+    for(uint8_t i=0; i<MEMORY_PHASES; i++){
+        Serial.print(' ');
+        if(_measured & bit(i))
+            Serial.print(_minFree[i]);
+        else
+            Serial.print('-');
+    }
+    Serial.println();
+}
@@ -0,0 +1,54 @@
+#include <Arduino.h>
+
+/**
+ * SRAM usage probes.
+ *
+ * RAM between the heap and the stack is painted with a pattern at boot and
+ * again when a phase starts. When it ends, the untouched pattern above the
+ * heap is the least free RAM the phase (interrupts included) left. Reports
+ * go to Serial in DBG builds, scopes compile to nothing otherwise.
+ */
+
+enum MemoryPhase {
+    MEMORY_SETUP,
+    MEMORY_READOUT,
+    MEMORY_DATA,
+    MEMORY_VCC,
+    MEMORY_HISTORY,
+    MEMORY_PHASES
+};
+
+
+class MemoryProbe {
+    private:
+        static uint16_t _minFree[MEMORY_PHASES];
+        static uint8_t _measured;
+    public:
+        static uint16_t freeRam();
+        static void begin(MemoryPhase phase);
+        static void end(MemoryPhase phase);
+        static uint16_t minFree(MemoryPhase phase);
+        static void report();
+};
+
+
+// records the least free RAM of a phase for the lifetime of the scope
+#ifdef DBG
+class MemoryScope {
+    private:
+        MemoryPhase _phase;
+    public:
+        MemoryScope(MemoryPhase phase){
+            _phase = phase;
+            MemoryProbe::begin(_phase);
+        }
+        ~MemoryScope(){
+            MemoryProbe::end(_phase);
+        }
+};
+#else
+class MemoryScope {
+    public:
+        MemoryScope(MemoryPhase phase){}
+};
+#endif
@@ -0,0 +1,58 @@
+#include "EpdDht22.h"
+#include <avr/wdt.h>
+#include <util/crc16.h>
+
+// bump when layout of `PersistentState` changes
+#define PERSISTENT_STATE_MAGIC 0xED04
+
+PersistentState persistentState __attribute__((section(".noinit")));
+uint8_t resetFlags __attribute__((section(".noinit")));
+
+
+/**
+ * Runs before the C runtime initializes RAM. After a watchdog reset the
+ * watchdog stays enabled with the shortest timeout, so it has to be turned
+ * off before anything else. The simulator calls it itself.
+ */
+#ifdef __AVR__
+void saveResetFlags() __attribute__((naked, used, section(".init3")));
+#endif
+void saveResetFlags(){
+    resetFlags = MCUSR;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+
+static uint16_t _crc(){
+    const uint8_t *data = (const uint8_t *)&persistentState;
+    uint16_t crc = 0xFFFF;
+    for(uint16_t i=0; i<offsetof(PersistentState, crc); i++)
+        crc = _crc16_update(crc, data[i]);
+    return crc;
+}
+
+
+/**
+ * RAM content is random after power-on. Some bootloaders clear MCUSR, then
+ * only the magic and CRC decide.
+ */
+bool persistentStateValid(){
+    if(resetFlags & _BV(PORF))
+        return false;
+    return persistentState.magic == PERSISTENT_STATE_MAGIC &&
+           persistentState.crc == _crc();
+}
+
+
+void persistentStateReset(){
+    memset(&persistentState, 0, sizeof(persistentState));
+    persistentState.magic = PERSISTENT_STATE_MAGIC;
+    persistentStateSeal();
+}
+
+
+// call after every change of `persistentState`
+void persistentStateSeal(){
+    persistentState.crc = _crc();
+}
@@ -0,0 +1,43 @@
+/**
+ * Pins of the board, shared by src/main.ino and the benchmark firmware.
+ * Include it after EpdDht22.h, the checks below need its settings.
+ */
+
+#ifdef __AVR_ATmega1284P__
+// MightyCore standard pinout, port D is on pins 8-15 there and the BUSY
+// pin change interrupt is on port C
+#define PIN_DHT 10
+#define PIN_DHT_2 12
+#define PIN_DHT_3 14
+#define TRANSISTOR_SWITCH_PIN 13
+#define EPD_BUSY_PIN 23
+#define BUTTON_PIN 11   // INT1
+#else
+// DHT22 data pins, all of them have to be on port D
+#define PIN_DHT 2 
+#define PIN_DHT_2 4
+#define PIN_DHT_3 6
+#define TRANSISTOR_SWITCH_PIN 5
+#define EPD_BUSY_PIN 7
+#define BUTTON_PIN 3    // INT1
+#endif
+
+// the DHT22 decoder samples a single port, see Dht22.h
+#ifdef __AVR_ATmega1284P__
+#define DHT22_PORT_PIN(pin) ((pin) >= 8 && (pin) <= 15)     // port D
+#else
+#define DHT22_PORT_PIN(pin) ((pin) <= 7)                    // port D
+#endif
+#if !DHT22_PORT_PIN(PIN_DHT) || \
+    (DHT22_SENSORS > 1 && !DHT22_PORT_PIN(PIN_DHT_2)) || \
+    (DHT22_SENSORS > 2 && !DHT22_PORT_PIN(PIN_DHT_3))
+#error "the DHT22 pins have to be on port D"
+#endif
+
+// chip select of the sample log idles high with a pull-up, a sensor on the
+// same pin would get it and the SPI traffic
+#if defined(SAMPLE_LOG) && (LOG_CS_PIN == PIN_DHT || \
+    (DHT22_SENSORS > 1 && LOG_CS_PIN == PIN_DHT_2) || \
+    (DHT22_SENSORS > 2 && LOG_CS_PIN == PIN_DHT_3))
+#error "LOG_CS_PIN is one of the DHT22 pins"
+#endif
@@ -0,0 +1,83 @@
+#include "PowerDomain.h"
+#include <avr/power.h>
+#include <avr/sleep.h>
+
+// parts with two power reduction registers have the same bits in PRR0
+#if !defined(PRR) && defined(PRR0)
+#define PRR PRR0
+#endif
+
+// PRR bits indexed by `Peripheral`
+static const uint8_t PRR_BITS[PERIPHERALS] = {
+    _BV(PRADC),
+    _BV(PRSPI),
+    _BV(PRUSART0),
+    _BV(PRTIM1),
+    _BV(PRTIM2),
+    _BV(PRTWI)
+};
+
+uint8_t PowerDomain::_users[PERIPHERALS];
+
+
+/**
+ * Gates everything, the Arduino core leaves ADC, timers and TWI clocked.
+ */
+void PowerDomain::begin(){
+    for(uint8_t i=0; i<PERIPHERALS; i++){
+        _users[i] = 0;
+        _disable((Peripheral)i);
+    }
+}
+
+
+void PowerDomain::_enable(Peripheral peripheral){
+    PRR &= ~PRR_BITS[peripheral];
+    if(peripheral == PERIPH_ADC)
+        ADCSRA |= _BV(ADEN);
+}
+
+
+void PowerDomain::_disable(Peripheral peripheral){
+    // ADC has to be disabled before its clock is stopped, otherwise it keeps
+    // drawing current in sleep
+    if(peripheral == PERIPH_ADC)
+        ADCSRA &= ~_BV(ADEN);
+    if(peripheral == PERIPH_USART)
+        Serial.flush();
+    PRR |= PRR_BITS[peripheral];
+}
+
+
+void PowerDomain::acquire(Peripheral peripheral){
+    if(_users[peripheral]++ == 0)
+        _enable(peripheral);
+}
+
+
+void PowerDomain::release(Peripheral peripheral){
+    if(_users[peripheral] == 0)
+        return;
+    if(--_users[peripheral] == 0)
+        _disable(peripheral);
+}
+
+
+bool PowerDomain::enabled(Peripheral peripheral){
+    return _users[peripheral] > 0;
+}
+
+
+/**
+ * Power-down sleep with brown-out detector off until the next interrupt.
+ */
+void PowerDomain::deepSleep(){
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    noInterrupts();
+    sleep_enable();
+    // BOD disable only lasts for `sleep_cpu()` following within 3 cycles
+    sleep_bod_disable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+}
@@ -0,0 +1,49 @@
+#include <Arduino.h>
+
+/**
+ * Power gating of on-chip peripherals.
+ *
+ * Every user acquires a peripheral for the time it needs it and releases it
+ * afterwards. Peripherals are reference counted, so nested users (Vcc read
+ * while rendering) keep the peripheral on until the outermost one releases
+ * it. Timer0 (`millis()`) is never gated.
+ */
+
+enum Peripheral {
+    PERIPH_ADC,
+    PERIPH_SPI,
+    PERIPH_USART,
+    PERIPH_TIMER1,
+    PERIPH_TIMER2,
+    PERIPH_TWI,
+    PERIPHERALS
+};
+
+
+class PowerDomain {
+    private:
+        static uint8_t _users[PERIPHERALS];
+        static void _enable(Peripheral peripheral);
+        static void _disable(Peripheral peripheral);
+    public:
+        static void begin();
+        static void acquire(Peripheral peripheral);
+        static void release(Peripheral peripheral);
+        static bool enabled(Peripheral peripheral);
+        static void deepSleep();
+};
+
+
+// acquires peripheral for the lifetime of the scope
+class PowerScope {
+    private:
+        Peripheral _peripheral;
+    public:
+        PowerScope(Peripheral peripheral){
+            _peripheral = peripheral;
+            PowerDomain::acquire(_peripheral);
+        }
+        ~PowerScope(){
+            PowerDomain::release(_peripheral);
+        }
+};
@@ -0,0 +1,190 @@
+#include "SampleLog.h"
+#include "Dht22.h"
+
+// the sensor number is in the low bits of a stamp
+static_assert(DHT22_SENSORS <= 1 << LOG_SENSOR_BITS,
+              "sensor numbers do not fit LOG_SENSOR_BITS");
+
+
+SampleLog::SampleLog(){
+    _mounted = false;
+    _empty = true;
+    _head = 0;
+    _sequence = 0;
+    _nextSlot = 0;
+    _slotOffset = 0;
+    _clocked = false;
+    _batched = 0;
+    _oldest = 0;
+    _reader = 0;
+}
+
+
+bool SampleLog::_header(uint16_t sector, LogHeader *header){
+    LogDevice::read((uint32_t)sector * LOG_SECTOR_SIZE, header,
+                    sizeof(LogHeader));
+    return header->magic == LOG_MAGIC;
+}
+
+
+bool SampleLog::_erased(uint32_t address){
+    uint32_t stamp;
+    LogDevice::read(address, &stamp, sizeof(stamp));
+    return stamp == LOG_ERASED;
+}
+
+
+/**
+ * The newest sector has the highest sequence, the head is its first erased
+ * record. The slot counter continues after the last record.
+ */
+void SampleLog::_mount(){
+    _mounted = true;
+
+    int16_t newest = -1;
+    for(uint16_t sector=0; sector<LOG_SECTORS; sector++){
+        LogHeader header;
+        if(!_header(sector, &header))
+            continue;
+        if(newest < 0 || header.sequence > _sequence){
+            newest = sector;
+            _sequence = header.sequence;
+        }
+    }
+    if(newest < 0)
+        return;
+    _empty = false;
+
+    // records of a sector are written from its start, erased ones follow
+    uint32_t start = (uint32_t)newest * LOG_SECTOR_SIZE;
+    uint16_t low = 1;
+    uint16_t high = LOG_SECTOR_RECORDS + 1;
+    while(low < high){
+        uint16_t middle = (low + high) / 2;
+        if(_erased(start + middle * sizeof(LogRecord)))
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    _head = (start + low * sizeof(LogRecord)) % LOG_SIZE;
+
+    // last record, it can be at the end of the previous sector when the
+    // header of this one was the last thing written
+    uint32_t last = (start + (low - 1) * sizeof(LogRecord));
+    if(last == start)
+        last = (start + LOG_SIZE - sizeof(LogRecord)) % LOG_SIZE;
+    LogRecord record;
+    LogDevice::read(last, &record, sizeof(record));
+    if(record.stamp != LOG_ERASED && record.stamp != LOG_MAGIC)
+        _nextSlot = (record.stamp >> LOG_SENSOR_BITS) + 1;
+}
+
+
+void SampleLog::_openSector(uint32_t address){
+    LogDevice::erase(address);
+    LogHeader header = { LOG_MAGIC, ++_sequence };
+    LogDevice::program(address, &header, sizeof(header));
+    _head = address + sizeof(header);
+    _empty = false;
+}
+
+
+/**
+ * `clock` counts slots, it restarts with a power loss. The
+ * first append after mounting continues the slots of the log from there.
+ */
+void SampleLog::append(uint32_t clock, uint8_t sensor, int16_t temperature,
+                       int16_t humidity){
+    if(!_mounted){
+        LogScope scope;
+        _mount();
+    }
+    if(!_clocked){
+        _slotOffset = _nextSlot > clock ? _nextSlot - clock : 0;
+        _clocked = true;
+    }
+
+    LogRecord *record = &_batch[_batched++];
+    record->stamp = ((clock + _slotOffset) << LOG_SENSOR_BITS) | sensor;
+    record->temperature = temperature;
+    record->humidity = humidity;
+
+    if(_batched == LOG_BATCH)
+        flush();
+}
+
+
+// programs the batch, split at page boundaries; sectors end with a page
+void SampleLog::flush(){
+    if(!_batched)
+        return;
+
+    LogScope scope;
+    uint8_t i = 0;
+    while(i < _batched){
+        if(_head % LOG_SECTOR_SIZE == 0)
+            _openSector(_head);
+
+        uint8_t count = min((uint16_t)(_batched - i),
+            (uint16_t)((LOG_PAGE_SIZE - _head % LOG_PAGE_SIZE) /
+                       sizeof(LogRecord)));
+        LogDevice::program(_head, &_batch[i], count * sizeof(LogRecord));
+        _head = (_head + count * sizeof(LogRecord)) % LOG_SIZE;
+        i += count;
+    }
+    _batched = 0;
+}
+
+
+// first written sector after the newest one, the log is contiguous
+uint16_t SampleLog::_oldestSector(){
+    uint16_t newest = ((_head + LOG_SIZE - 1) % LOG_SIZE) / LOG_SECTOR_SIZE;
+    for(uint16_t i=1; i<LOG_SECTORS; i++){
+        uint16_t sector = (newest + i) % LOG_SECTORS;
+        LogHeader header;
+        if(_header(sector, &header))
+            return sector;
+    }
+    return newest;
+}
+
+
+/**
+ * Records in the memory, after `rewind()`. Sectors before the newest one
+ * are full.
+ */
+uint32_t SampleLog::records(){
+    if(_empty)
+        return 0;
+    uint32_t end = (_head + LOG_SIZE - 1) % LOG_SIZE;
+    uint16_t newest = end / LOG_SECTOR_SIZE;
+    uint16_t full = (newest + LOG_SECTORS - _oldest) % LOG_SECTORS;
+    return (uint32_t)full * LOG_SECTOR_RECORDS +
+           (end % LOG_SECTOR_SIZE + 1) / sizeof(LogRecord) - 1;
+}
+
+
+/**
+ * Sequential reading from the oldest record, programs the batch first.
+ * Reading has to be inside a `LogScope`.
+ */
+void SampleLog::rewind(){
+    if(!_mounted)
+        _mount();
+    flush();
+    _oldest = _oldestSector();
+    _reader = _empty ? _head :
+        (uint32_t)_oldest * LOG_SECTOR_SIZE + sizeof(LogHeader);
+}
+
+
+bool SampleLog::next(LogRecord *record){
+    if(_empty || _reader == _head)
+        return false;
+    if(_reader % LOG_SECTOR_SIZE == 0)
+        _reader += sizeof(LogHeader);
+
+    LogDevice::read(_reader, record, sizeof(LogRecord));
+    _reader = (_reader + sizeof(LogRecord)) % LOG_SIZE;
+    return true;
+}
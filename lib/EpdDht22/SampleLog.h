@@ -0,0 +1,75 @@
+#include "LogDevice.h"
+
+/**
+ * Every slot's sample of every sensor, appended to the SPI memory as
+ * a circular log.
+ *
+ * The memory is used sector by sector. A sector starts with a header with
+ * the sequence number of the sector, followed by records. Entering a sector
+ * erases it, which drops the oldest one, so all sectors wear evenly.
+ * Records are collected in RAM and programmed in batches, a batch is split
+ * only at page boundaries. Mounting reads the sector headers and finds the
+ * end of the newest sector by a binary search for the first erased record.
+ *
+ * Records are stamped with a slot counter (`Config::slotCycles`). It
+ * continues the log across power loss; the gap of a power loss itself is
+ * not recorded.
+ */
+
+// no value, failed readout
+#define LOG_NO_VALUE INT16_MIN
+
+#define LOG_ERASED 0xFFFFFFFFUL
+#define LOG_MAGIC 0x4C4F4731UL     // "LOG1"
+#define LOG_SENSOR_BITS 2
+
+// records collected before they are programmed
+#ifndef LOG_BATCH
+#define LOG_BATCH 4
+#endif
+
+
+struct LogRecord {
+    uint32_t stamp;         // slot << LOG_SENSOR_BITS | sensor
+    int16_t temperature;    // tenths
+    int16_t humidity;       // tenths
+};
+
+
+struct LogHeader {
+    uint32_t magic;
+    uint32_t sequence;
+};
+
+
+#define LOG_SECTOR_RECORDS (LOG_SECTOR_SIZE / sizeof(LogRecord) - 1)
+
+
+class SampleLog {
+    private:
+        bool _mounted;
+        uint32_t _head;         // address of the next record
+        uint32_t _sequence;     // of the sector with the head
+        uint32_t _nextSlot;     // after the last record when mounted
+        uint32_t _slotOffset;   // slot of the log minus the slot clock
+        bool _clocked;
+        bool _empty;
+        LogRecord _batch[LOG_BATCH];
+        uint8_t _batched;
+        uint16_t _oldest;
+        uint32_t _reader;
+
+        void _mount();
+        bool _header(uint16_t sector, LogHeader *header);
+        bool _erased(uint32_t address);
+        void _openSector(uint32_t address);
+        uint16_t _oldestSector();
+    public:
+        SampleLog();
+        void append(uint32_t clock, uint8_t sensor, int16_t temperature,
+                    int16_t humidity);
+        void flush();
+        uint32_t records();
+        void rewind();
+        bool next(LogRecord *record);
+};
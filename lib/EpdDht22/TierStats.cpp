@@ -0,0 +1,102 @@
+#include "TierStats.h"
+
+
+TierStats::TierStats(uint8_t capacity){
+    _capacity = capacity;
+    clear();
+}
+
+
+void TierStats::clear(){
+    _size = 0;
+    _valid = 0;
+    _sumX = _sumXX = _sumY = _sumXY = 0;
+    clearRange();
+}
+
+
+bool TierStats::full(){
+    return _size == _capacity;
+}
+
+
+/**
+ * Removes the oldest position of the window and moves the others one
+ * position back. Returns true when min/max have to be rescanned.
+ */
+bool TierStats::evict(int16_t value, bool valid){
+    if(!_size)
+        return false;
+    _size--;
+
+    bool rescan = false;
+    if(valid){
+        _valid--;
+        _sumY -= value;
+        rescan = (value == _min || value == _max);
+    }
+
+    // the oldest one was at position 0, the rest moves from x to x - 1
+    _sumXX -= 2 * _sumX - _valid;
+    _sumX -= _valid;
+    _sumXY -= _sumY;
+    return rescan;
+}
+
+
+void TierStats::add(int16_t value, bool valid){
+    uint8_t x = _size++;
+    if(!valid)
+        return;
+
+    _valid++;
+    _sumX += x;
+    _sumXX += (int32_t)x * x;
+    _sumY += value;
+    _sumXY += (int32_t)x * value;
+    extendRange(value);
+}
+
+
+void TierStats::clearRange(){
+    _min = INT16_MAX;
+    _max = INT16_MIN;
+}
+
+
+void TierStats::extendRange(int16_t value){
+    if(value < _min)
+        _min = value;
+    if(value > _max)
+        _max = value;
+}
+
+
+uint8_t TierStats::count(){
+    return _valid;
+}
+
+
+int16_t TierStats::minimum(){
+    return _valid ? _min : 0;
+}
+
+
+int16_t TierStats::maximum(){
+    return _valid ? _max : 0;
+}
+
+
+/**
+ * Least-squares slope in hundredths per window position, 0 with less than
+ * three values.
+ */
+int16_t TierStats::slope(){
+    if(_valid < 3)
+        return 0;
+    int32_t numerator = _valid * _sumXY - _sumX * _sumY;
+    int32_t denominator = _valid * _sumXX - _sumX * _sumX;
+    if(!denominator)
+        return 0;
+    return numerator * 10 / denominator;
+}
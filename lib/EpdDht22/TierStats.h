@@ -0,0 +1,43 @@
+#include <Arduino.h>
+
+/**
+ * Running statistics of a sliding window of samples in tenths.
+ *
+ * Integer sums of the values and their products with the position in the
+ * window are updated on each push and eviction, so the least-squares slope
+ * costs O(1). Sums are exact, so removing samples does not accumulate
+ * error. Positions of missing samples stay empty. Min/max need a rescan of
+ * the window only when the evicted sample was one of them.
+ */
+
+class TierStats {
+    private:
+        uint8_t _capacity;
+        uint8_t _size;      // positions in the window
+        uint8_t _valid;     // positions with a value
+        int32_t _sumX;
+        int32_t _sumXX;
+        int32_t _sumY;
+        int32_t _sumXY;
+        int16_t _min;
+        int16_t _max;
+    public:
+        TierStats(uint8_t capacity);
+        void clear();
+        bool full();
+        bool evict(int16_t value, bool valid);
+        void add(int16_t value, bool valid);
+        void clearRange();
+        void extendRange(int16_t value);
+
+        uint8_t count();
+        int16_t minimum();
+        int16_t maximum();
+        int16_t slope();
+};
+
+
+// rounds to tenths without libm
+inline int16_t toTenths(float value){
+    return (int16_t)(value * 10 + (value < 0 ? -0.5 : 0.5));
+}
@@ -0,0 +1,67 @@
+/**
+ * DHT22 driver of the simulator, samples come from the trace instead of
+ * the bus.
+ */
+#include "Dht22.h"
+
+// sim.cpp
+bool simSensorSample(uint8_t sensor, int16_t *temperature, uint16_t *humidity);
+
+
+Dht22::Dht22(const uint8_t *pins, uint8_t count){
+    _pins = pins;
+    _count = min(count, (uint8_t)DHT22_SENSORS);
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        _status[i] = DHT22_TIMEOUT;
+        _temperature[i] = 0;
+        _humidity[i] = 0;
+    }
+}
+
+
+void Dht22::begin(){
+}
+
+
+uint8_t Dht22::read(uint8_t attempts){
+    uint8_t pending = (1 << _count) - 1;
+
+    // a failed row of the trace fails all the attempts, as a missing sensor
+    for(uint8_t a=0; a<attempts && pending; a++){
+        if(a > 0)
+            delay(DHT22_RETRY_PAUSE);
+        for(uint8_t i=0; i<_count; i++){
+            if(!(pending & bit(i)))
+                continue;
+            bool valid = simSensorSample(i, &_temperature[i], &_humidity[i]);
+            _status[i] = valid ? DHT22_OK : DHT22_TIMEOUT;
+            if(valid)
+                pending &= ~bit(i);
+        }
+    }
+
+    uint8_t ok = 0;
+    for(uint8_t i=0; i<_count; i++)
+        if(!(pending & bit(i)))
+            ok++;
+    return ok;
+}
+
+
+Dht22Status Dht22::status(uint8_t sensor){
+    return _status[sensor];
+}
+
+
+float Dht22::temperature(uint8_t sensor){
+    if(_status[sensor] != DHT22_OK)
+        return NAN;
+    return _temperature[sensor] / 10.;
+}
+
+
+float Dht22::humidity(uint8_t sensor){
+    if(_status[sensor] != DHT22_OK)
+        return NAN;
+    return _humidity[sensor] / 10.;
+}
@@ -0,0 +1,99 @@
+/**
+ * Sample log memory of the simulator, kept in a file with `--log FILE` and
+ * in memory otherwise. It enforces the rules of NOR flash for both chip
+ * types: programming only clears bits and stays within a page.
+ */
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LogDevice.h"
+
+// sim.cpp
+extern const char *simLogPath;
+
+static std::vector<uint8_t> _memory;
+
+
+static void _fail(const char *message, uint32_t address){
+    fprintf(stderr, "log device: %s at 0x%06lx\n", message,
+            (unsigned long)address);
+    exit(2);
+}
+
+
+// writes the changed bytes through, a new file gets all of them
+static void _save(uint32_t address, uint32_t length){
+    if(!simLogPath)
+        return;
+    FILE *file = fopen(simLogPath, "r+b");
+    if(!file){
+        file = fopen(simLogPath, "wb");
+        address = 0;
+        length = LOG_SIZE;
+    }
+    if(!file)
+        _fail("cannot write the file", address);
+    fseek(file, address, SEEK_SET);
+    fwrite(&_memory[address], 1, length, file);
+    fclose(file);
+}
+
+
+// a new chip reads erased as NOR and zeroed as FRAM
+static void _load(){
+    if(!_memory.empty())
+        return;
+#ifdef LOG_FRAM
+    _memory.assign(LOG_SIZE, 0x00);
+#else
+    _memory.assign(LOG_SIZE, 0xFF);
+#endif
+    FILE *file = simLogPath ? fopen(simLogPath, "rb") : NULL;
+    if(file){
+        if(fread(_memory.data(), 1, LOG_SIZE, file) != LOG_SIZE)
+            _fail("short file", 0);
+        fclose(file);
+    }
+}
+
+
+// no panel to power, the bus is not simulated
+void LogDevice::panelRail(uint8_t pin, const uint16_t *settle){
+}
+
+
+void LogDevice::begin(){
+    _load();
+}
+
+
+void LogDevice::end(){
+}
+
+
+void LogDevice::read(uint32_t address, void *data, uint16_t length){
+    if(address + length > LOG_SIZE)
+        _fail("read past the end", address);
+    memcpy(data, &_memory[address], length);
+}
+
+
+void LogDevice::program(uint32_t address, const void *data, uint16_t length){
+    const uint8_t *bytes = (const uint8_t *)data;
+    if(address / LOG_PAGE_SIZE != (address + length - 1) / LOG_PAGE_SIZE)
+        _fail("program across a page", address);
+    for(uint16_t i=0; i<length; i++){
+        if(bytes[i] & ~_memory[address + i])
+            _fail("program without erase", address + i);
+        _memory[address + i] &= bytes[i];
+    }
+    _save(address, length);
+}
+
+
+void LogDevice::erase(uint32_t address){
+    address -= address % LOG_SECTOR_SIZE;
+    memset(&_memory[address], 0xFF, LOG_SECTOR_SIZE);
+    _save(address, LOG_SECTOR_SIZE);
+}
@@ -0,0 +1,519 @@
+/**
+ * Virtual clock simulator of the firmware.
+ *
+ * Runs the real `setup()`/`loop()` and the EpdDht22 library on the host.
+ * `delay()`, sleep and the watchdog advance simulated time instantly, the
+ * DHT22 returns samples of a recorded trace and the panel only counts its
+ * refreshes. Energy is estimated from the time spent in each state.
+ *
+ *   epdsim TRACE.csv [--days N] [--vcc MV] [--verbose] [--export FILE]
+ *          [--log FILE] [--press SECONDS]...
+ *
+ * Trace rows are `seconds,temperature,humidity[,vcc]`, lines starting with
+ * `#` or a letter are skipped and an empty value is a failed sensor read.
+ * A trace shorter than the simulated period is replayed over and over.
+ *
+ * `--export` sends the export command after the simulated period and
+ * writes what the firmware answers to FILE, for tools/export_csv.py.
+ * `--log` keeps the memory of the sample log (SAMPLE_LOG builds) in FILE,
+ * a later run continues it.
+ * `--press` pushes the button at SECONDS of simulated time, it is released
+ * right away.
+ */
+// standard library first, Arduino.h defines `min` and `max` macros
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <ctype.h>
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <avr/power.h>
+#include <avr/eeprom.h>
+#include <SPI.h>
+
+// supply current estimates in mA for a 3.3 V Pro Mini without regulator
+// and power LED
+#define CURRENT_ACTIVE 3.6
+#define CURRENT_IDLE 1.0
+#define CURRENT_POWER_DOWN 0.005    // watchdog on, BOD off
+#define CURRENT_SENSOR 0.04         // DHT22 standby, always powered
+#define CURRENT_PANEL_REFRESH 3.0
+
+// part of the CPU current which does not scale with the clock
+#define CURRENT_STATIC_SHARE 0.1
+
+#define WDT_PERIOD_MS 8000L
+#define FULL_REFRESH_MS 2000L
+#define PARTIAL_REFRESH_MS 300L
+#define DHT22_FRAME_US 5000L
+
+#define US_PER_DAY (86400ULL * 1000000ULL)
+
+enum SimState {
+    SIM_ACTIVE,
+    SIM_IDLE,
+    SIM_POWER_DOWN
+};
+
+struct TraceRow {
+    unsigned long seconds;
+    bool valid;
+    float temperature;
+    float humidity;
+    long vcc;
+};
+
+struct DayStats {
+    unsigned long wakes;
+    unsigned long screens;
+    unsigned long fullRefreshes;
+    unsigned long partialRefreshes;
+    unsigned long pages;
+    unsigned long sensorReads;
+    unsigned long failedReads;
+    double awakeMs;
+    double mAh;
+};
+
+// registers
+volatile uint8_t ADMUX, ADCL, ADCH, MCUSR, WDTCSR, PRR, SMCR, PCICR, PCIFR;
+volatile uint8_t PCMSK0, PCMSK1, PCMSK2, EIMSK, EIFR, EICRA;
+volatile uint8_t TCCR1A, TCCR1B, TIFR1, TIFR0, SPCR, SPSR, SPDR, GPIOR0, CLKPR, SREG;
+volatile uint8_t UCSR0A, UCSR0B;
+volatile uint16_t TCNT1;
+volatile uint8_t simPortInput[5];
+SimAdcsra ADCSRA;
+
+// millisecond counter of the Arduino core, CpuClock corrects it
+volatile unsigned long timer0_millis;
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+// firmware
+void setup();
+void loop();
+void saveResetFlags();
+extern "C" void WDT_vect();
+
+static uint64_t _now;               // real time in us
+static unsigned long _timer0Us;     // timer0 fraction of a millisecond
+static uint8_t _prescaler;
+static uint8_t _sleepMode;
+static bool _verbose;
+static FILE *_serialOut;
+static std::string _serialIn;
+
+// LogDeviceFile.cpp
+const char *simLogPath;
+static long _defaultVcc = 3300;
+
+// external interrupts, button presses in us
+static void (*_interrupts[2])(void);
+static std::vector<uint64_t> _presses;
+static size_t _pressIndex;
+static uint32_t _pullUps;
+static uint64_t _wdtDue;
+
+static uint8_t _eeprom[1024];
+
+static std::vector<TraceRow> _trace;
+static size_t _traceIndex;
+static std::vector<DayStats> _days;
+
+
+static DayStats *_today(){
+    size_t day = _now / US_PER_DAY;
+    if(_days.size() <= day)
+        _days.resize(day + 1, DayStats());
+    return &_days[day];
+}
+
+
+/**
+ * Trace row at the current time, a trace shorter than the simulation is
+ * replayed from its beginning.
+ */
+static const TraceRow *_sample(){
+    if(_trace.empty())
+        return NULL;
+
+    unsigned long seconds = (_now / 1000000ULL) % (_trace.back().seconds + 1);
+    if(seconds < _trace[_traceIndex].seconds)
+        _traceIndex = 0;
+    while(_traceIndex + 1 < _trace.size() &&
+          _trace[_traceIndex + 1].seconds <= seconds)
+        _traceIndex++;
+    return &_trace[_traceIndex];
+}
+
+
+/**
+ * Moves real time by `us`, accounts energy of the state and runs timer0
+ * with the current clock prescaler.
+ */
+static void _advance(uint64_t us, SimState state, double extra = 0.){
+    double factor = 1 << _prescaler;
+    double cpu = state == SIM_ACTIVE ? CURRENT_ACTIVE :
+                 state == SIM_IDLE ? CURRENT_IDLE : CURRENT_POWER_DOWN;
+    if(state != SIM_POWER_DOWN)
+        cpu *= CURRENT_STATIC_SHARE + (1. - CURRENT_STATIC_SHARE) / factor;
+
+    DayStats *day = _today();
+    day->mAh += (cpu + CURRENT_SENSOR + extra) * us / 3.6e9;
+    if(state != SIM_POWER_DOWN)
+        day->awakeMs += us / 1000.;
+
+    _now += us;
+
+    // timer0 is stopped in power down
+    if(state == SIM_POWER_DOWN)
+        return;
+    _timer0Us += us / (1 << _prescaler);
+    timer0_millis += _timer0Us / 1000;
+    _timer0Us %= 1000;
+}
+
+
+void cli(){}
+void sei(){}
+
+void pinMode(uint8_t pin, uint8_t mode){
+    if(mode == INPUT_PULLUP)
+        _pullUps |= 1UL << pin;
+    else
+        _pullUps &= ~(1UL << pin);
+}
+
+// the pull-up is switched off by writing LOW
+void digitalWrite(uint8_t pin, uint8_t value){
+    if(value == LOW)
+        _pullUps &= ~(1UL << pin);
+}
+
+// only low level interrupts wake from power down
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode){
+    if(irq < 2 && mode == LOW)
+        _interrupts[irq] = isr;
+}
+
+void detachInterrupt(uint8_t irq){
+    if(irq < 2)
+        _interrupts[irq] = NULL;
+}
+
+// BUSY is never held, refresh time is accounted by the panel, a button is
+// released right after the press
+int digitalRead(uint8_t pin){
+    return _pullUps & (1UL << pin) ? HIGH : LOW;
+}
+
+unsigned long millis(){
+    return timer0_millis;
+}
+
+unsigned long micros(){
+    return timer0_millis * 1000 + _timer0Us;
+}
+
+void delay(unsigned long ms){
+    yield();
+    _advance((uint64_t)ms * 1000 << _prescaler, SIM_ACTIVE);
+}
+
+void delayMicroseconds(unsigned int us){
+    _advance((uint64_t)us << _prescaler, SIM_ACTIVE);
+}
+
+
+void set_sleep_mode(uint8_t mode){
+    _sleepMode = mode;
+}
+
+void sleep_enable(){}
+void sleep_disable(){}
+void sleep_bod_disable(){}
+
+void sleep_cpu(){
+    if(_sleepMode != SLEEP_MODE_PWR_DOWN){
+        // next timer0 overflow
+        _advance(1024ULL << _prescaler, SIM_IDLE);
+        return;
+    }
+
+    // the edge of the first byte wakes the MCU, the byte itself is lost
+    if(!_serialIn.empty() && (PCMSK2 & _BV(digitalPinToPCMSKbit(0)))){
+        _serialIn.erase(0, 1);
+        _advance(1000, SIM_POWER_DOWN);
+        return;
+    }
+
+    if(!(WDTCSR & _BV(WDIE))){
+        fprintf(stderr, "power down without wake-up source at %.1f s\n",
+                _now / 1e6);
+        exit(2);
+    }
+
+    // the watchdog counts from the first sleep after it was enabled, the
+    // time awake after other wakes included
+    if(!_wdtDue)
+        _wdtDue = _now + WDT_PERIOD_MS * 1000ULL;
+
+    // presses while awake are lost, the interrupt was not armed
+    while(_pressIndex < _presses.size() && _presses[_pressIndex] < _now)
+        _pressIndex++;
+    for(uint8_t irq=0; irq<2; irq++){
+        if(!_interrupts[irq] || _pressIndex == _presses.size() ||
+           _presses[_pressIndex] >= _wdtDue)
+            continue;
+        _advance(_presses[_pressIndex++] - _now, SIM_POWER_DOWN);
+        _interrupts[irq]();
+        return;
+    }
+
+    if(_wdtDue > _now)
+        _advance(_wdtDue - _now, SIM_POWER_DOWN);
+    WDT_vect();
+}
+
+void sleep_mode(){
+    sleep_cpu();
+}
+
+
+void eeprom_read_block(void *dst, const void *src, size_t n){
+    memcpy(dst, _eeprom + (size_t)src, n);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n){
+    memcpy(_eeprom + (size_t)dst, src, n);
+}
+
+
+void wdt_reset(){}
+
+void wdt_enable(uint8_t timeout){
+    WDTCSR |= _BV(WDE);
+}
+
+void wdt_disable(){
+    WDTCSR = 0;
+    _wdtDue = 0;
+}
+
+
+void clock_prescale_set(clock_div_t divider){
+    _prescaler = divider;
+}
+
+clock_div_t clock_prescale_get(){
+    return (clock_div_t)_prescaler;
+}
+
+
+void SimAdcsra::_convert(){
+    if(!(value & _BV(ADSC)))
+        return;
+
+    const TraceRow *row = _sample();
+    long vcc = row && row->vcc ? row->vcc : _defaultVcc;
+    uint16_t result = 1126400L / vcc;
+    ADCL = result & 0xFF;
+    ADCH = result >> 8;
+    value &= ~_BV(ADSC);
+    _advance(110, SIM_ACTIVE);
+}
+
+
+int HardwareSerial::available(){
+    return _serialIn.size();
+}
+
+int HardwareSerial::read(){
+    if(_serialIn.empty())
+        return -1;
+    int c = (uint8_t)_serialIn[0];
+    _serialIn.erase(0, 1);
+    return c;
+}
+
+size_t HardwareSerial::write(uint8_t c){
+    // a gated USART ignores its registers, the sketch would hang on a full
+    // transmit buffer
+    if(PRR & _BV(PRUSART0)){
+        fprintf(stderr, "serial output with the USART gated at %.1f s\n",
+                _now / 1e6);
+        exit(2);
+    }
+    if(_verbose)
+        putchar(c);
+    if(_serialOut)
+        fputc(c, _serialOut);
+    return 1;
+}
+
+
+// printScreen() of the sketch powers the panel up for each screen update
+void simPanelInit(){
+    _today()->screens++;
+}
+
+void simPanelPages(uint8_t pages){
+    _today()->pages += pages;
+}
+
+void simPanelRefresh(bool full, uint16_t w, uint16_t h){
+    DayStats *day = _today();
+    if(full)
+        day->fullRefreshes++;
+    else
+        day->partialRefreshes++;
+
+    // MCU sleeps in idle while BUSY is held; a partial refresh drives only
+    // the window
+    long ms = full ? FULL_REFRESH_MS : PARTIAL_REFRESH_MS;
+    _advance(ms * 1000ULL, SIM_IDLE, CURRENT_PANEL_REFRESH * (full ? 1. :
+             (double)w * h / (200. * 200.)));
+}
+
+
+/**
+ * Sensor sample at the current time, false when the trace has a gap.
+ */
+bool simSensorSample(uint8_t sensor, int16_t *temperature, uint16_t *humidity){
+    _advance(DHT22_FRAME_US, SIM_ACTIVE);
+
+    DayStats *day = _today();
+    day->sensorReads++;
+
+    const TraceRow *row = _sample();
+    if(!row || !row->valid){
+        day->failedReads++;
+        return false;
+    }
+    *temperature = (int16_t)lround(row->temperature * 10);
+    *humidity = (uint16_t)lround(row->humidity * 10);
+    return true;
+}
+
+
+static bool _loadTrace(const char *path){
+    FILE *file = fopen(path, "r");
+    if(!file)
+        return false;
+
+    char line[256];
+    while(fgets(line, sizeof(line), file)){
+        if(line[0] == '#' || isalpha((unsigned char)line[0]) || line[0] == '\n')
+            continue;
+
+        TraceRow row = { 0, true, 0., 0., 0 };
+        std::vector<std::string> fields(1);
+        for(char *c = line; *c && *c != '\n' && *c != '\r'; c++){
+            if(*c == ',')
+                fields.push_back("");
+            else
+                fields.back() += *c;
+        }
+        row.seconds = strtoul(fields[0].c_str(), NULL, 10);
+        if(fields.size() < 3 || fields[1].empty() || fields[2].empty())
+            row.valid = false;
+        else {
+            row.temperature = atof(fields[1].c_str());
+            row.humidity = atof(fields[2].c_str());
+        }
+        if(fields.size() > 3 && !fields[3].empty())
+            row.vcc = atol(fields[3].c_str());
+        _trace.push_back(row);
+    }
+    fclose(file);
+    return !_trace.empty();
+}
+
+
+static void _report(){
+    DayStats total = DayStats();
+    printf("day,wakes,screens,full,partial,pages,reads,failed,awake_ms,mAh\n");
+    for(size_t i=0; i<_days.size(); i++){
+        DayStats *d = &_days[i];
+        printf("%zu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.0f,%.3f\n", i + 1, d->wakes,
+               d->screens, d->fullRefreshes, d->partialRefreshes, d->pages,
+               d->sensorReads, d->failedReads, d->awakeMs, d->mAh);
+        total.wakes += d->wakes;
+        total.screens += d->screens;
+        total.fullRefreshes += d->fullRefreshes;
+        total.partialRefreshes += d->partialRefreshes;
+        total.pages += d->pages;
+        total.sensorReads += d->sensorReads;
+        total.failedReads += d->failedReads;
+        total.awakeMs += d->awakeMs;
+        total.mAh += d->mAh;
+    }
+    printf("total,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.0f,%.3f\n", total.wakes,
+           total.screens, total.fullRefreshes, total.partialRefreshes,
+           total.pages, total.sensorReads, total.failedReads, total.awakeMs,
+           total.mAh);
+}
+
+
+int main(int argc, char **argv){
+    const char *path = NULL;
+    double days = 0;
+    const char *exportPath = NULL;
+
+    for(int i=1; i<argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--days" && i + 1 < argc)
+            days = atof(argv[++i]);
+        else if(arg == "--vcc" && i + 1 < argc)
+            _defaultVcc = atol(argv[++i]);
+        else if(arg == "--verbose")
+            _verbose = true;
+        else if(arg == "--export" && i + 1 < argc)
+            exportPath = argv[++i];
+        else if(arg == "--log" && i + 1 < argc)
+            simLogPath = argv[++i];
+        else if(arg == "--press" && i + 1 < argc)
+            _presses.push_back(atof(argv[++i]) * 1e6);
+        else
+            path = argv[i];
+    }
+
+    if(!path || !_loadTrace(path)){
+        fprintf(stderr, "usage: %s TRACE.csv [--days N] [--vcc MV] "
+                        "[--verbose] [--export FILE] [--log FILE] "
+                        "[--press SECONDS]...\n", argv[0]);
+        return 1;
+    }
+    std::sort(_presses.begin(), _presses.end());
+    if(days <= 0)
+        days = (_trace.back().seconds + 1) / 86400.;
+
+    memset(_eeprom, 0xFF, sizeof(_eeprom));
+    MCUSR = _BV(PORF);
+    saveResetFlags();
+    setup();
+
+    uint64_t end = days * US_PER_DAY;
+    while(_now < end){
+        _today()->wakes++;
+        loop();
+    }
+
+    _days.resize((end + US_PER_DAY - 1) / US_PER_DAY);
+    _report();
+
+    // the host repeats the command until the node answers
+    if(exportPath){
+        _serialOut = fopen(exportPath, "wb");
+        if(!_serialOut){
+            perror(exportPath);
+            return 1;
+        }
+        _serialIn = "EE";
+        loop();
+        fclose(_serialOut);
+    }
+    return 0;
+}
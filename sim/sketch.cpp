@@ -0,0 +1,12 @@
+/**
+ * The sketch as the Arduino builder sees it: prototypes first, then the
+ * `.ino` source.
+ */
+#include <Arduino.h>
+
+void readout();
+void printScreen();
+void armButton();
+void buttonWake();
+
+#include "../src/main.ino"
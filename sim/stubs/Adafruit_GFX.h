@@ -0,0 +1,146 @@
+/**
+ * Minimal Adafruit GFX for the simulator. Primitives end up in
+ * `drawPixel()`; text draws a fixed 5x7 pattern per character, which is
+ * enough to tell different strings apart.
+ */
+#pragma once
+#include <Arduino.h>
+
+typedef struct {
+    uint16_t bitmapOffset;
+    uint8_t width, height, xAdvance;
+    int8_t xOffset, yOffset;
+} GFXglyph;
+
+typedef struct {
+    uint8_t *bitmap;
+    GFXglyph *glyph;
+    uint8_t first, last, yAdvance;
+} GFXfont;
+
+
+class Adafruit_GFX : public Print {
+    public:
+        Adafruit_GFX(int16_t w, int16_t h){
+            WIDTH = _width = w;
+            HEIGHT = _height = h;
+            cursor_x = cursor_y = 0;
+            rotation = 0;
+            textcolor = 0;
+            gfxFont = NULL;
+        }
+        virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+        virtual void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                               uint16_t color){
+            int16_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+            int16_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+            int16_t err = dx + dy;
+            while(true){
+                drawPixel(x0, y0, color);
+                if(x0 == x1 && y0 == y1)
+                    break;
+                int16_t e2 = 2 * err;
+                if(e2 >= dy){ err += dy; x0 += sx; }
+                if(e2 <= dx){ err += dx; y0 += sy; }
+            }
+        }
+        void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color){
+            writeLine(x0, y0, x1, y1, color);
+        }
+        virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color){
+            writeLine(x, y, x + w - 1, y, color);
+        }
+        virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color){
+            writeLine(x, y, x, y + h - 1, color);
+        }
+        void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color){
+            if(w <= 0 || h <= 0)
+                return;
+            drawFastHLine(x, y, w, color);
+            drawFastHLine(x, y + h - 1, w, color);
+            drawFastVLine(x, y, h, color);
+            drawFastVLine(x + w - 1, y, h, color);
+        }
+        virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color){
+            for(int16_t i=0; i<h; i++)
+                drawFastHLine(x, y + i, w, color);
+        }
+        virtual void fillScreen(uint16_t color){
+            fillRect(0, 0, _width, _height, color);
+        }
+        void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color){
+            // fan from the first corner, enough for small shapes
+            int16_t steps = max(abs(x2 - x1), abs(y2 - y1));
+            for(int16_t i=0; i<=steps; i++)
+                writeLine(x0, y0, x1 + (steps ? (x2 - x1) * i / steps : 0),
+                          y1 + (steps ? (y2 - y1) * i / steps : 0), color);
+        }
+        void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color){
+            drawPixel(x0, y0 - r, color);
+            drawPixel(x0, y0 + r, color);
+        }
+
+        void setCursor(int16_t x, int16_t y){ cursor_x = x; cursor_y = y; }
+        void setFont(const GFXfont *f){ gfxFont = (GFXfont *)f; }
+        void setTextColor(uint16_t c){ textcolor = c; }
+        void setRotation(uint8_t r){ rotation = r & 3; }
+        int16_t width() const { return _width; }
+        int16_t height() const { return _height; }
+        int16_t getCursorX() const { return cursor_x; }
+        int16_t getCursorY() const { return cursor_y; }
+        void getTextBounds(const char *s, int16_t x, int16_t y, int16_t *x1,
+                           int16_t *y1, uint16_t *w, uint16_t *h){
+            *x1 = x;
+            *y1 = y - 7;
+            *w = strlen(s) * 6;
+            *h = 8;
+        }
+
+        size_t write(uint8_t c) override {
+            if(c == '\n'){
+                cursor_x = 0;
+                cursor_y += 8;
+                return 1;
+            }
+            for(uint8_t col=0; col<5; col++){
+                uint8_t pattern = (uint8_t)(c * 37 + col * 11);
+                for(uint8_t row=0; row<7; row++)
+                    if(pattern & (1 << row))
+                        drawPixel(cursor_x + col, cursor_y - 7 + row, textcolor);
+            }
+            cursor_x += 6;
+            return 1;
+        }
+        using Print::write;
+    protected:
+        int16_t WIDTH, HEIGHT, _width, _height, cursor_x, cursor_y;
+        uint16_t textcolor;
+        uint8_t rotation;
+        GFXfont *gfxFont;
+};
+
+
+class GFXcanvas1 : public Adafruit_GFX {
+    public:
+        GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h){
+            _buffer = new uint8_t[((w + 7) / 8) * h]();
+        }
+        ~GFXcanvas1(){ delete[] _buffer; }
+        void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+            if(x < 0 || y < 0 || x >= _width || y >= _height)
+                return;
+            uint8_t *b = &_buffer[(x / 8) + y * ((WIDTH + 7) / 8)];
+            if(color)
+                *b |= (0x80 >> (x & 7));
+            else
+                *b &= ~(0x80 >> (x & 7));
+        }
+        void fillScreen(uint16_t color) override {
+            memset(_buffer, color ? 0xFF : 0x00, ((WIDTH + 7) / 8) * HEIGHT);
+        }
+        uint8_t *getBuffer(){ return _buffer; }
+    private:
+        uint8_t *_buffer;
+};
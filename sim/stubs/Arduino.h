@@ -0,0 +1,126 @@
+/**
+ * Host stand-in of the Arduino AVR core for the simulator. Time related
+ * functions run on the virtual clock in sim.cpp.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 8000000L
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define SS 10
+#define MOSI 11
+#define SCK 13
+#define NOT_A_PIN 0
+#define NOT_AN_INTERRUPT -1
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+#define digitalPinToPort(p) ((p) < 8 ? 4 : ((p) < 14 ? 2 : 3))
+#define digitalPinToBitMask(p) ((uint8_t)(1 << ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14))))
+#define digitalPinToPCICRbit(p) ((p) <= 7 ? 2 : ((p) <= 13 ? 0 : 1))
+#define digitalPinToPCMSKbit(p) ((p) <= 7 ? (p) : ((p) <= 13 ? (p) - 8 : (p) - 14))
+extern volatile uint8_t simPortInput[5];
+#define portInputRegister(port) (&simPortInput[port])
+
+#define bit(b) (1UL << (b))
+#define bitRead(v, b) (((v) >> (b)) & 1)
+#define F(s) (s)
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t irq);
+void yield();
+
+
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size){
+            for(size_t i=0; i<size; i++)
+                write(buffer[i]);
+            return size;
+        }
+        size_t write(const char *s){ return print(s); }
+        size_t print(const char *s){
+            size_t n = 0;
+            while(*s)
+                n += write((uint8_t)*s++);
+            return n;
+        }
+        size_t print(char c){ return write((uint8_t)c); }
+        size_t print(long v, int base = DEC){ return _number(base == HEX ? "%lX" : "%ld", v); }
+        size_t print(unsigned long v, int base = DEC){ return _number(base == HEX ? "%lX" : "%lu", v); }
+        size_t print(int v, int base = DEC){ return print((long)v, base); }
+        size_t print(unsigned int v, int base = DEC){ return print((unsigned long)v, base); }
+        size_t print(unsigned char v, int base = DEC){ return print((unsigned long)v, base); }
+        size_t print(double v, int digits = 2){
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.*f", digits, v);
+            return print(buffer);
+        }
+        size_t println(){ return print("\r\n"); }
+        template <typename T> size_t println(T v){ size_t n = print(v); return n + println(); }
+        template <typename T> size_t println(T v, int f){ size_t n = print(v, f); return n + println(); }
+    private:
+        template <typename T> size_t _number(const char *format, T v){
+            char buffer[24];
+            snprintf(buffer, sizeof(buffer), format, v);
+            return print(buffer);
+        }
+};
+
+
+class Stream : public Print {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+};
+
+
+// goes to stdout with `--verbose`, the input is fed from sim.cpp
+class HardwareSerial : public Stream {
+    public:
+        void begin(unsigned long baud){}
+        void end(){}
+        void flush(){}
+        int available() override;
+        int read() override;
+        size_t write(uint8_t c) override;
+        using Print::write;
+        operator bool(){ return true; }
+};
+
+extern HardwareSerial Serial;
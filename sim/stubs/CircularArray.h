@@ -0,0 +1,37 @@
+/**
+ * Stand-in for the circular-array library: a ring over the caller's array,
+ * filled from the first slot, `get(0)` is the oldest item.
+ */
+#pragma once
+#include <stdint.h>
+
+template <typename T>
+class CircularArray {
+    private:
+        T *_buffer;
+        uint16_t _capacity;
+        uint16_t _head;
+        uint16_t _size;
+    public:
+        CircularArray(T *buffer, uint16_t capacity){
+            _buffer = buffer;
+            _capacity = capacity;
+            _head = 0;
+            _size = 0;
+        }
+        void push(T item){
+            _buffer[_head] = item;
+            _head = (_head + 1) % _capacity;
+            if(_size < _capacity)
+                _size++;
+        }
+        T *get(uint16_t i){
+            return &_buffer[(_head + _capacity - _size + i) % _capacity];
+        }
+        T *last(){
+            return get(_size - 1);
+        }
+        uint16_t size(){
+            return _size;
+        }
+};
@@ -0,0 +1,3 @@
+#pragma once
+
+static const GFXfont TomThumb = { 0, 0, 0x20, 0x7E, 6 };
@@ -0,0 +1,95 @@
+/**
+ * GDEP015OC1 driver stand-in. Pages are drawn into nothing; a refresh
+ * reports itself to the simulator, which accounts its BUSY time.
+ */
+#pragma once
+#include <Adafruit_GFX.h>
+#include <SPI.h>
+
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+namespace GxEPD2 {
+    enum Panel { GDEP015OC1 };
+}
+
+// sim.cpp
+void simPanelInit();
+void simPanelRefresh(bool full, uint16_t w, uint16_t h);
+void simPanelPages(uint8_t pages);
+
+class GxEPD2_AVR_BW : public Adafruit_GFX {
+    public:
+        static const uint16_t WIDTH = 200;
+        static const uint16_t HEIGHT = 200;
+        static const uint16_t PAGE_HEIGHT = 200 / 8;
+
+        GxEPD2_AVR_BW(GxEPD2::Panel panel, int8_t cs, int8_t dc, int8_t rst,
+                      int8_t busy) : Adafruit_GFX(200, 200){
+            _initial = true;
+            _partial = false;
+            _page = 0;
+            _pages = 1;
+            _w = _h = 200;
+        }
+        void init(uint32_t serial_diag_bitrate = 0){
+            init(serial_diag_bitrate, true);
+        }
+        void init(uint32_t serial_diag_bitrate, bool initial,
+                  bool pulldown_rst_mode = false){
+            _initial = initial;
+            simPanelInit();
+        }
+        void drawPixel(int16_t x, int16_t y, uint16_t color) override {}
+        void fillScreen(uint16_t color) override {}
+        void setFullWindow(){
+            _partial = false;
+            _w = _h = 200;
+        }
+        void setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h){
+            _partial = true;
+            _w = w;
+            _h = h;
+        }
+        void firstPage(){
+            _page = 0;
+            _pages = (_h + PAGE_HEIGHT - 1) / PAGE_HEIGHT;
+        }
+        bool nextPage(){
+            if(++_page < _pages)
+                return true;
+            simPanelPages(_pages);
+            _refresh(!_partial);
+            return false;
+        }
+        void writeImage(const uint8_t *bitmap, int16_t x, int16_t y, int16_t w,
+                        int16_t h, bool invert = false, bool mirror_y = false,
+                        bool pgm = false){
+            _w = w;
+            _h = h;
+            simPanelPages(1);
+        }
+        void refresh(bool partial_update_mode = false){
+            _refresh(!partial_update_mode);
+        }
+        void refresh(int16_t x, int16_t y, int16_t w, int16_t h){
+            _w = w;
+            _h = h;
+            _refresh(false);
+        }
+        void powerOff(){}
+        void hibernate(){}
+    private:
+        bool _initial;
+        bool _partial;
+        uint8_t _page;
+        uint8_t _pages;
+        uint16_t _w, _h;
+
+        // the driver turns the first partial refresh after `init()` into a
+        // full one
+        void _refresh(bool full){
+            simPanelRefresh(full || _initial, _w, _h);
+            _initial = false;
+        }
+};
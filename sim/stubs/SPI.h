@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+
+#define SPI_MODE0 0
+#define MSBFIRST 1
+
+struct SPISettings {
+    SPISettings(){}
+    SPISettings(uint32_t clock, uint8_t order, uint8_t mode){}
+};
+
+class SPIClass {
+    public:
+        static void begin(){}
+        static void end(){}
+        static void beginTransaction(SPISettings settings){}
+        static void endTransaction(){}
+        static uint8_t transfer(uint8_t data){ return 0xFF; }
+};
+
+extern SPIClass SPI;
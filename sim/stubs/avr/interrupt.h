@@ -0,0 +1,9 @@
+#pragma once
+
+// vectors become plain functions the simulator can call
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+#define EMPTY_INTERRUPT(vector) extern "C" void vector(void) {}
+#define ISR_NOBLOCK
+
+void cli();
+void sei();
@@ -0,0 +1,89 @@
+/**
+ * ATmega328P registers used by the firmware, as plain memory. ADCSRA is
+ * a proxy which finishes a conversion as soon as it is started.
+ */
+#pragma once
+#include <stdint.h>
+
+#define __AVR_ATmega328P__ 1
+
+#define SIM_REGISTER(name) extern volatile uint8_t name;
+SIM_REGISTER(ADMUX) SIM_REGISTER(ADCL) SIM_REGISTER(ADCH)
+SIM_REGISTER(MCUSR) SIM_REGISTER(WDTCSR) SIM_REGISTER(PRR) SIM_REGISTER(SMCR)
+SIM_REGISTER(PCICR) SIM_REGISTER(PCIFR)
+SIM_REGISTER(PCMSK0) SIM_REGISTER(PCMSK1) SIM_REGISTER(PCMSK2)
+SIM_REGISTER(EIMSK) SIM_REGISTER(EIFR) SIM_REGISTER(EICRA)
+SIM_REGISTER(TCCR1A) SIM_REGISTER(TCCR1B) SIM_REGISTER(TIFR1)
+SIM_REGISTER(TIFR0)
+SIM_REGISTER(SPCR) SIM_REGISTER(SPSR) SIM_REGISTER(SPDR)
+SIM_REGISTER(GPIOR0) SIM_REGISTER(CLKPR) SIM_REGISTER(SREG)
+SIM_REGISTER(UCSR0A) SIM_REGISTER(UCSR0B)
+extern volatile uint16_t TCNT1;
+
+struct SimAdcsra {
+    volatile uint8_t value;
+    operator uint8_t() const { return value; }
+    SimAdcsra &operator=(int v){ value = v; _convert(); return *this; }
+    SimAdcsra &operator|=(int v){ value |= v; _convert(); return *this; }
+    SimAdcsra &operator&=(int v){ value &= v; return *this; }
+    private:
+        void _convert();
+};
+extern SimAdcsra ADCSRA;
+
+#define _BV(b) (1 << (b))
+#define bit_is_set(r, b) ((r) & _BV(b))
+#define bit_is_clear(r, b) (!((r) & _BV(b)))
+
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define REFS0 6
+#define ADSC 6
+#define ADEN 7
+
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+
+#define PRADC 0
+#define PRUSART0 1
+#define PRSPI 2
+#define PRTIM1 3
+#define PRTIM0 5
+#define PRTIM2 6
+#define PRTWI 7
+
+#define TOV0 0
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define INTF0 0
+#define INTF1 1
+#define INT0 0
+#define INT1 1
+#define ISC10 2
+#define ISC11 3
+#define SPR0 0
+#define SPR1 1
+#define MSTR 4
+#define SPE 6
+#define SPIE 7
+#define SPIF 7
+#define SPI2X 0
+
+#define RAMSTART 0x100
+#define RAMEND 0x8FF
+#define E2END 0x3FF
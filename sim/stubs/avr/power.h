@@ -0,0 +1,9 @@
+#pragma once
+
+typedef enum {
+    clock_div_1 = 0, clock_div_2, clock_div_4, clock_div_8, clock_div_16,
+    clock_div_32, clock_div_64, clock_div_128, clock_div_256
+} clock_div_t;
+
+void clock_prescale_set(clock_div_t divider);
+clock_div_t clock_prescale_get();
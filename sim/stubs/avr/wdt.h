@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+#define WDTO_15MS 0
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_8S 9
+
+void wdt_reset();
+void wdt_enable(uint8_t timeout);
+void wdt_disable();
@@ -0,0 +1,4 @@
+#pragma once
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) for(int _done = 0; !_done; _done = 1)
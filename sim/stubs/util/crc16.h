@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a){
+    crc ^= a;
+    for(uint8_t i=0; i<8; i++)
+        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+    return crc;
+}
+
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data){
+    data ^= (crc & 0xFF);
+    data ^= data << 4;
+    return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^
+            ((uint16_t)data << 3));
+}
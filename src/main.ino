@@ -1,15 +1,23 @@
 #include "Arduino.h"
 #include <avr/sleep.h>
 #include <avr/wdt.h>
-#include <myavrsleep.h>
 #include <EpdDht22.h>
+#include <PowerDomain.h>
+#include <BusyWait.h>
+#include <MemoryProbe.h>
+#include <Console.h>
+#include <Pins.h>
 #include <math.h>
 
-#define PIN_DHT 2 
 //#define DHT_TYPE DHT22
-#define INTERVAL 60000  // sensor read out interval
 
-#define TRANSISTOR_SWITCH_PIN 5
+// e-paper power sequencing settle times in ms, measure them per board
+#define POWER_UP_SETTLE 20
+#define POWER_DOWN_SETTLE 0
+
+// screen cadence of the normal power profile
+#define SCREEN_PERIOD 4
+#define FULL_REFRESH_PERIOD 1
 
 const bool TURN_ON=1; 
 const bool TURN_OFF=0;
@@ -24,30 +32,54 @@ GxEPD2_AVR_BW *display;
  * kazdych 30 cyklov (5 min) --> vycitat senzor do buffer
  * kazdych 120 cyklov (20 min) --> vykreslit s priemerom za 5 min
  * kazdych 720 cyklov (2 hod) --> vypocitat priemer za 2h a vykreslit graf
+ *
+ * Cycles of a slot are configurable, the averages are in slots.
  */
 
 #ifdef DBG
     #define FIVE_MIN 3  // 30 number of cycles during 5 minutes
-    #define TWENTY_MIN 12 // 120 number of cycles during 20 min
-    #define TWO_HOUR 72  // 720 number of cycles during 2 hours
 #else
     #define FIVE_MIN 30  // 30 number of cycles during 5 minutes
-    #define TWENTY_MIN 120 // 120 number of cycles during 20 min
-    #define TWO_HOUR 720  // 720 number of cycles during 2 hours
 #endif
 
-volatile char sleepCnt = 0;
+volatile uint8_t sleepCnt = 0;
 
-uint8_t numberOfWakes = 0;
+// set by the button interrupt, handled after the wake
+volatile bool buttonPressed = false;
+
+// survives non power-on resets together with the sample buffers
+uint8_t &numberOfWakes = persistentState.numberOfWakes;
 
 Settings settings {
-    PIN_DHT,
+    {
+        PIN_DHT,
+#if DHT22_SENSORS > 1
+        PIN_DHT_2,
+#endif
+#if DHT22_SENSORS > 2
+        PIN_DHT_3,
+#endif
+    },
     TRANSISTOR_SWITCH_PIN, 
 #ifdef DBG
-    development
+    development,
 #else
-    production
+    production,
 #endif
+    EPD_BUSY_PIN,
+    // defaults, a record in EEPROM replaces them
+    {
+        FIVE_MIN,
+        SCREEN_PERIOD,
+        FULL_REFRESH_PERIOD,
+        READ_DHT22_PAUSE,
+        POWER_UP_SETTLE,
+        POWER_DOWN_SETTLE,
+        VCC_SAVER,
+        VCC_CRITICAL,
+        VCC_HYSTERESIS,
+        TREND_THRESHOLD
+    }
 };
 
 
@@ -55,103 +87,154 @@ static EpdDht22 *epdDht22;
 
 
 void setup(){
-    Serial.begin(115200);
+    MemoryScope memory(MEMORY_SETUP);
+
+    // everything is gated until somebody asks for it; the USART keeps its
+    // configuration while gated, logging and the console acquire it
+    PowerDomain::begin();
+    PowerScope usart(PERIPH_USART);
+
+    Serial.begin(CONSOLE_BAUD);
     Serial.println(F("setup"));
 
     epdDht22 = new EpdDht22(&settings);
-    epdDht22->powerDown();
+    if(epdDht22->restored()){
+        Serial.print(F("state restored after reset, flags: "));
+        Serial.println(resetFlags, HEX);
+    }
 }
 
 
 void loop(){
+    const ProfileSettings *profile = epdDht22->profile();
 
-    Serial.print("Number of wakes: ");
-    Serial.println(numberOfWakes);
-
-    Serial.println("Read sensor .... ");
-    readout();
-
-    if((numberOfWakes % (uint16_t)(TWENTY_MIN / FIVE_MIN)) == 0) {
-        Serial.println("Once in 20min: 5 min average and draw screen ...");
+    if(profile->serialLog){
+        PowerScope usart(PERIPH_USART);
+        Serial.print("Number of wakes: ");
+        Serial.println(numberOfWakes);
+        Serial.println("Read sensor .... ");
+    }
+    // sensor converts while the screen refreshes; averages are computed from
+    // the samples taken before this wake, so they are not waiting for it
+    epdDht22->startReadout();
+    epdDht22->measureVcc();
+
+    if((numberOfWakes % AVERAGE_SLOTS) == 0) {
+        if(profile->serialLog){
+            PowerScope usart(PERIPH_USART);
+            Serial.println("Once in 20min: 5 min average and draw screen ...");
+        }
         epdDht22->twentyMinuteAverage();
     }
 
-    if((numberOfWakes % (uint16_t)(TWO_HOUR / FIVE_MIN) == 0)){
-        Serial.println("Once in 2h: 20 min average and draw history ...");
+    if((numberOfWakes % HISTORY_SLOTS == 0)){
+        if(profile->serialLog){
+            PowerScope usart(PERIPH_USART);
+            Serial.println("Once in 2h: 20 min average and draw history ...");
+        }
         epdDht22->twoHourAverage();
         numberOfWakes = 0;
+        persistentStateSeal();
     }
 
-    if((numberOfWakes % (uint16_t)(TWENTY_MIN / FIVE_MIN)) == 0) {
+    // nothing new to show when all the readouts since the last update failed
+    if((numberOfWakes % profile->screenPeriod) == 0 &&
+       epdDht22->hasFreshSamples()) {
         printScreen();
     }
 
+    readout();
+#ifdef DBG
+    MemoryProbe::report();
+#endif
 
-   // Disable the ADC (Analog to digital converter, pins A0 [14] to A5 [19])
-   //static byte prevADCSRA = ADCSRA;
-   //ADCSRA = 0; 
-   //set_sleep_mode(SLEEP_MODE_PWR_DOWN);
-   //sleep_enable();
+    // choose power profile for the next period by supply voltage
+    epdDht22->updatePowerProfile();
+    profile = epdDht22->profile();
 
-   while (sleepCnt <= FIVE_MIN ) {
+    // number of 5 min slots to sleep, aligned to the profile sample period
+    uint8_t slots = profile->samplePeriod - 
+                    (numberOfWakes % profile->samplePeriod);
 
-        // Turn of Brown Out Detection (low voltage). This is automatically re-enabled upon timer interrupt
-        //sleep_bod_disable();
+   // ADC and other peripherals are gated by `PowerDomain` when not in use
+   while (sleepCnt < settings.config.slotCycles * slots) {
 
         // Ensure we can wake up again by first disabling interrupts (temporarily) so
         // the wakeISR does not run before we are asleep and then prevent interrupts,
         // and then defining the ISR (Interrupt Service Routine) to run when poked awake by the timer
         noInterrupts();
 
-        // clear various "reset" flags
-        MCUSR = 0; 	// allow changes, disable reset
-        WDTCSR = bit (WDCE) | bit(WDE); // set interrupt mode and an interval
-        WDTCSR = bit (WDIE) | bit(WDP3) | bit(WDP2) | bit(WDP1) | bit(WDP0);    // set WDIE, and 1 second delay
-        wdt_reset();
-
-        // Send a message just to show we are about to sleep
-        //Serial.println("Good night!");
-        Serial.flush();
+        // the watchdog keeps running through a button or serial wake, so
+        // those do not stretch the period
+        if(!(WDTCSR & bit(WDIE))){
+            // clear various "reset" flags
+            MCUSR = 0; 	// allow changes, disable reset
+            WDTCSR = bit (WDCE) | bit(WDE); // set interrupt mode and an interval
+            WDTCSR = bit (WDIE) | bit(WDP3) | bit(WDP2) | bit(WDP1) | bit(WDP0);    // set WDIE, and 1 second delay
+            wdt_reset();
+        }
 
         // Allow interrupts now
         interrupts();
 
-        // And enter sleep mode as set above
-        //sleep_cpu();
-
-        avrDeepSleep();
+        // power down with brown out detection off, the watchdog, the button
+        // or the first edge of a serial command wakes it
+        uint8_t cycles = sleepCnt;
+        armButton();
+        Console::armWake();
+        PowerDomain::deepSleep();
+        Console::disarmWake();
+        if(buttonPressed){
+            buttonPressed = false;
+            epdDht22->showCurrent();
+        }
+        else if(sleepCnt == cycles)
+            Console::listen(epdDht22);
    }
 
     // --------------------------------------------------------
     // Controller is now asleep until woken up by an interrupt
     // --------------------------------------------------------
 
-    // Prevent sleep mode, so we don't enter it again, except deliberately, by code
-    //sleep_disable();
-
     // Wakes up at this point when timer wakes up C
-    Serial.println("I'm awake!");
-    numberOfWakes++;
+    if(profile->serialLog){
+        PowerScope usart(PERIPH_USART);
+        Serial.println("I'm awake!");
+    }
+    numberOfWakes += slots;
+    persistentState.slotClock += slots;
+    persistentStateSeal();
 
 
     // Reset sleep counter
     sleepCnt = 0;
 
-    // Re-enable ADC if it was previously running
-    //ADCSRA = prevADCSRA;
-    avrEnableAdc();
-    delay(1000);
+    sleepFor(1000);
 }
 
 
 void readout(){
     //epdDht22->powerUp();
 
-    Dht22Data _tmp = epdDht22->readDht22();
-    Serial.print("Temperature: ");
-    Serial.print(_tmp.temperature);
-    Serial.print(" Humidity:: ");
-    Serial.println(_tmp.humidity);
+    epdDht22->finishReadout();
+    if(!epdDht22->profile()->serialLog)
+        return;
+
+    PowerScope usart(PERIPH_USART);
+    FixedText text;
+    for(uint8_t i=0; i<DHT22_SENSORS; i++){
+        Dht22Data *_tmp = epdDht22->lastReading(i);
+        if(!_tmp->samples){
+            Serial.println("Readout failed");
+            continue;
+        }
+        Serial.print("Temperature: ");
+        formatFixed(text, toTenths(_tmp->temperature), 1, 1);
+        Serial.print(text);
+        Serial.print(" Humidity:: ");
+        formatFixed(text, toTenths(_tmp->humidity), 1, 1);
+        Serial.println(text);
+    }
 }
 
 
@@ -161,6 +244,26 @@ void printScreen(){
     epdDht22->powerDown();
 }
 
+/**
+ * Only a low level wakes from power down, so the interrupt disables itself
+ * and is armed again once the button is released. Contacts bounce for
+ * milliseconds while a readout takes seconds; a button still held keeps it
+ * disarmed until the next watchdog wake, no busy waiting either way.
+ */
+void armButton(){
+    // `powerDown()` leaves the pin without the pull-up
+    pinMode(BUTTON_PIN, INPUT_PULLUP);
+    if(digitalRead(BUTTON_PIN) == HIGH)
+        attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), buttonWake, LOW);
+}
+
+
+void buttonWake(){
+    detachInterrupt(digitalPinToInterrupt(BUTTON_PIN));
+    buttonPressed = true;
+}
+
+
 // When WatchDog timer causes microcontroller to wake it comes here
 ISR (WDT_vect) {
 
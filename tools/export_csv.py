@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+Reads the history of a node over serial and writes it as CSV to stdout.
+
+    python tools/export_csv.py /dev/ttyUSB0 > node.csv
+    python tools/export_csv.py --file capture.bin > node.csv
+
+The node answers the export command only after the command woke it, so it
+is repeated until the acknowledgement comes; then the block follows at the
+export baud rate. `--file` reads a capture instead, e.g. from
+`sim/epdsim --export`. The block format is described in
+lib/EpdDht22/Console.h. A port needs pyserial.
+"""
+import argparse
+import csv
+import struct
+import sys
+import time
+
+CONSOLE_BAUD = 115200
+EXPORT_BAUD = 500000
+EXPORT_ACK = 0x06
+EXPORT_MAGIC = 0x5845
+EXPORT_VERSION = 3
+EXPORT_LOG = 3
+EXPORT_END = 0xFF
+
+# how long to repeat the command, in seconds
+WAKE_TIMEOUT = 5
+REPEAT_INTERVAL = 0.1
+
+TIERS = ('5min', '20min', '2h')
+
+# failed readout in the sample log
+LOG_NO_VALUE = -32768
+LOG_SENSOR_BITS = 2
+
+
+class Reader:
+    """Reads exactly the requested bytes and keeps the CRC of them."""
+
+    def __init__(self, read):
+        self._read = read
+        self.crc = 0xFFFF
+
+    def bytes(self, count, checked=True):
+        data = self._read(count)
+        if len(data) < count:
+            sys.exit('export block truncated')
+        if checked:
+            for byte in data:
+                self.crc ^= byte
+                for _ in range(8):
+                    self.crc = (self.crc >> 1) ^ 0xA001 \
+                        if self.crc & 1 else self.crc >> 1
+        return data
+
+    def unpack(self, layout, checked=True):
+        return struct.unpack(
+            layout, self.bytes(struct.calcsize(layout), checked))
+
+
+def parse(reader):
+    magic, version, sensors = reader.unpack('<HBB')
+    if magic != EXPORT_MAGIC:
+        sys.exit('not an export block')
+    if version != EXPORT_VERSION:
+        sys.exit('export version %d is not supported' % version)
+    # slot length is configurable on the node
+    slot_minutes = reader.unpack('<H')[0] / 60.
+
+    rows = []
+    log = []
+    while True:
+        tier, = reader.unpack('<B')
+        if tier == EXPORT_END:
+            break
+        sensor, slots, count = reader.unpack('<BBB')
+        minutes = slots * slot_minutes
+        if tier == EXPORT_LOG:
+            for _ in range(count):
+                log.append(reader.unpack('<Ihh') + (minutes,))
+            continue
+        for i in range(count):
+            temperature, humidity, samples = reader.unpack('<hhB')
+            rows.append((
+                TIERS[tier] if tier < len(TIERS) else tier,
+                sensor,
+                round((count - 1 - i) * minutes, 2),
+                temperature / 10. if samples else '',
+                humidity / 10. if samples else '',
+                samples,
+            ))
+
+    crc = reader.crc
+    if reader.unpack('<H', checked=False)[0] != crc:
+        sys.exit('export block CRC mismatch')
+    return rows + log_rows(log)
+
+
+def log_rows(log):
+    """Sample log records are stamped by slot, the newest one is now."""
+    if not log:
+        return []
+    newest = max(stamp for stamp, _, _, _ in log) >> LOG_SENSOR_BITS
+    rows = []
+    for stamp, temperature, humidity, minutes in log:
+        valid = temperature != LOG_NO_VALUE
+        rows.append((
+            'log',
+            stamp & ((1 << LOG_SENSOR_BITS) - 1),
+            round((newest - (stamp >> LOG_SENSOR_BITS)) * minutes, 2),
+            temperature / 10. if valid else '',
+            humidity / 10. if valid else '',
+            int(valid),
+        ))
+    return rows
+
+
+def skip_to_ack(read):
+    """Skips the serial log in front of the acknowledgement."""
+    while True:
+        data = read(1)
+        if not data:
+            return False
+        if data[0] == EXPORT_ACK:
+            return True
+
+
+def from_port(path):
+    import serial
+
+    port = serial.Serial(path, CONSOLE_BAUD, timeout=REPEAT_INTERVAL)
+    deadline = time.time() + WAKE_TIMEOUT
+    while time.time() < deadline:
+        port.write(b'E')
+        if skip_to_ack(port.read):
+            port.baudrate = EXPORT_BAUD
+            port.timeout = 1
+            return parse(Reader(port.read))
+    sys.exit('%s: no answer' % path)
+
+
+def from_file(path):
+    with open(path, 'rb') as capture:
+        if not skip_to_ack(capture.read):
+            sys.exit('%s: no export block' % path)
+        return parse(Reader(capture.read))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('port', nargs='?', help='serial port of the node')
+    parser.add_argument('--file', help='read a capture instead of a port')
+    args = parser.parse_args()
+    if not args.port and not args.file:
+        parser.error('a port or --file is needed')
+
+    rows = from_file(args.file) if args.file else from_port(args.port)
+    writer = csv.writer(sys.stdout)
+    writer.writerow(('tier', 'sensor', 'minutes_ago', 'temperature',
+                     'humidity', 'samples'))
+    writer.writerows(rows)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
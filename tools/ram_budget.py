@@ -0,0 +1,35 @@
+"""
+PlatformIO post build check of static RAM. `.data`, `.bss` and `.noinit`
+have to leave `custom_ram_reserve` bytes for the heap (display with its
+page buffer, sample buffers) and the stack, otherwise the build fails.
+Measure the real need with the DBG memory report before lowering it.
+"""
+import subprocess
+import sys
+
+Import("env")
+
+RAM_RESERVE = 1200
+
+
+def check_ram(source, target, env):
+    output = subprocess.check_output(
+        [env.subst("$SIZETOOL"), "-A", str(target[0])],
+        universal_newlines=True)
+    used = 0
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in (".data", ".bss", ".noinit"):
+            used += int(fields[1])
+
+    ram = int(env.BoardConfig().get("upload.maximum_ram_size", 2048))
+    reserve = int(env.GetProjectOption("custom_ram_reserve", RAM_RESERVE))
+    print("static RAM %d of %d bytes, %d reserved for heap and stack" % (
+        used, ram, reserve))
+    if used + reserve > ram:
+        sys.stderr.write("static RAM exceeds the budget by %d bytes\n" % (
+            used + reserve - ram))
+        env.Exit(1)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", check_ram)